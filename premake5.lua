@@ -77,6 +77,10 @@ project "sbp_experiment"
     files {
         "src/algorithms/top_down_sbp.cpp",
         "src/algorithms/bottom_up_sbp.cpp",
+        "src/algorithms/component_sbp.cpp",
+        "src/algorithms/pruned_sbp.cpp",
+        "src/algorithms/auto_k_sbp.cpp",
+        "src/algorithms/recursive_bisection_sbp.cpp",
         "src/main_sbp.cpp"
     }
 
@@ -90,6 +94,10 @@ project "sbp_benchmark"
     files {
         "src/algorithms/top_down_sbp.cpp",
         "src/algorithms/bottom_up_sbp.cpp",
+        "src/algorithms/component_sbp.cpp",
+        "src/algorithms/pruned_sbp.cpp",
+        "src/algorithms/auto_k_sbp.cpp",
+        "src/algorithms/recursive_bisection_sbp.cpp",
         "src/benchmark_sbp.cpp"
     }
 
@@ -54,13 +54,20 @@ PARALLEL_LARGE_CONFIGS = [
 ]
 
 
-def write_graph_config(configs, output_file):
+def write_graph_config(configs, output_file, directed=False):
     """Write graph configurations to a CSV file."""
+    fieldnames = ['n', 'k', 'p_in', 'p_out']
+    if directed:
+        fieldnames.append('directed')
+
     with open(output_file, 'w', newline='') as f:
-        writer = csv.DictWriter(f, fieldnames=['n', 'k', 'p_in', 'p_out'])
+        writer = csv.DictWriter(f, fieldnames=fieldnames)
         writer.writeheader()
         for config in configs:
-            writer.writerow(config)
+            row = dict(config)
+            if directed:
+                row['directed'] = 1
+            writer.writerow(row)
     print(f"Generated {len(configs)} configurations -> {output_file}")
 
 
@@ -89,6 +96,11 @@ Examples:
         default='scripts/graph_config.csv',
         help='Output CSV file path (default: scripts/graph_config.csv)'
     )
+    parser.add_argument(
+        '--directed',
+        action='store_true',
+        help='Generate directed SBM graphs (arcs sampled independently per direction)'
+    )
     
     args = parser.parse_args()
     
@@ -114,7 +126,7 @@ Examples:
     output_path.parent.mkdir(parents=True, exist_ok=True)
 
     # Write configurations
-    write_graph_config(configs, args.output)
+    write_graph_config(configs, args.output, directed=args.directed)
 
     print(f"\nScenario: {args.scenario}")
     print(f"Total configurations: {len(configs)}")
@@ -0,0 +1,167 @@
+#include "../headers/sbp_algorithms.hpp"
+
+namespace sbp {
+
+// A partition passed on the split/merge trajectory and its description length
+struct PartitionSnapshot {
+    utils::ClusterCount cluster_count{0};
+    utils::DescriptionLength h{utils::inf};
+    utils::ClusterAssignment assignment;
+};
+
+PartitionSnapshot take_snapshot(const utils::BlockModel& BM) {
+    return {BM.cluster_count, utils::compute_H(BM), BM.cluster_assignment};
+}
+
+void restore_snapshot(utils::Graph& G, utils::BlockModel& BM, const PartitionSnapshot& snapshot) {
+    double mcmc_time = BM.total_mcmc_time;
+    BM = utils::BlockModel(&G, snapshot.cluster_count);
+    BM.cluster_assignment = snapshot.assignment;
+    BM.update_matrix();
+    BM.total_mcmc_time = mcmc_time;
+}
+
+// low.K < mid.K < high.K with mid holding the smallest H seen so far
+struct PartitionBracket {
+    PartitionSnapshot low;
+    PartitionSnapshot mid;
+    PartitionSnapshot high;
+
+    [[nodiscard]] bool has_low() const { return !low.assignment.empty(); }
+    [[nodiscard]] bool has_high() const { return !high.assignment.empty(); }
+};
+
+// Places a new snapshot into the bracket, keeping mid at the best H
+void update_bracket(PartitionBracket& bracket, PartitionSnapshot&& snapshot) {
+    if (bracket.mid.assignment.empty()) {
+        bracket.mid = std::move(snapshot);
+        return;
+    }
+
+    bool above_mid = snapshot.cluster_count > bracket.mid.cluster_count;
+
+    if (snapshot.h < bracket.mid.h) {
+        // New best; the old mid becomes the bound on its side
+        if (above_mid) {
+            bracket.low = std::move(bracket.mid);
+        } else {
+            bracket.high = std::move(bracket.mid);
+        }
+        bracket.mid = std::move(snapshot);
+    } else if (above_mid) {
+        bracket.high = std::move(snapshot);
+    } else {
+        bracket.low = std::move(snapshot);
+    }
+}
+
+void auto_k_sbp(
+    utils::Graph& G,
+    utils::BlockModel& BM,
+    SbpAlgorithm algorithm,
+    utils::ProposalCount proposals_per_split,
+    utils::ClusterCount max_clusters,
+    const TopDownOptions& top_down_options,
+    const BottomUpOptions& bottom_up_options) {
+
+    utils::VertexCount vertex_count = G.get_vertex_count();
+    if (max_clusters == 0 || max_clusters > vertex_count) {
+        max_clusters = vertex_count;
+    }
+
+    bool top_down = (algorithm == SbpAlgorithm::TopDown);
+
+    // Moves BM from its current partition to target clusters (top-down only
+    // adds clusters, bottom-up only removes them)
+    auto run_to = [&](utils::ClusterCount target, bool resume) {
+        if (top_down) {
+            TopDownOptions options = top_down_options;
+            options.resume = resume;
+            top_down_sbp(G, BM, target, proposals_per_split, options);
+        } else {
+            BottomUpOptions options = bottom_up_options;
+            options.resume = resume;
+            bottom_up_sbp(G, BM, target, options);
+        }
+    };
+
+    PartitionBracket bracket;
+
+    // Exploration: grow (or shrink) K geometrically from where the algorithm
+    // starts until H goes back up past the best partition seen
+    utils::ClusterCount target = top_down
+        ? utils::minClusterCount
+        : std::max<utils::ClusterCount>(
+              utils::minClusterCount,
+              static_cast<utils::ClusterCount>(static_cast<utils::Probability>(vertex_count) * utils::autoKReductionFactor));
+    target = std::min(target, max_clusters);
+    run_to(target, false);
+    update_bracket(bracket, take_snapshot(BM));
+
+    while (top_down ? !bracket.has_high() : !bracket.has_low()) {
+        utils::ClusterCount current = BM.cluster_count;
+
+        if (top_down) {
+            if (current >= max_clusters) break;
+            target = std::max(
+                current + 1,
+                static_cast<utils::ClusterCount>(static_cast<utils::Probability>(current) * utils::autoKGrowthFactor)
+            );
+            target = std::min(target, max_clusters);
+        } else {
+            if (current <= utils::minClusterCount) break;
+            target = std::min(
+                current - 1,
+                static_cast<utils::ClusterCount>(static_cast<utils::Probability>(current) * utils::autoKReductionFactor)
+            );
+            target = std::max(target, utils::minClusterCount);
+        }
+
+        run_to(target, true);
+
+        // Top-down stops early once no cluster is worth splitting
+        if (BM.cluster_count == current) break;
+
+        update_bracket(bracket, take_snapshot(BM));
+    }
+
+    // Golden-section refinement: probe the wider side of the bracket, always
+    // starting from the neighbouring partition the algorithm can move away from
+    while (bracket.has_low() && bracket.has_high() &&
+           bracket.high.cluster_count - bracket.low.cluster_count > 2) {
+
+        utils::ClusterCount mid_k = bracket.mid.cluster_count;
+        utils::ClusterCount upper_gap = bracket.high.cluster_count - mid_k;
+        utils::ClusterCount lower_gap = mid_k - bracket.low.cluster_count;
+        bool probe_above = upper_gap >= lower_gap;
+
+        auto step = std::max<utils::ClusterCount>(
+            1,
+            static_cast<utils::ClusterCount>(std::round(
+                utils::goldenSectionRatio * static_cast<utils::Probability>(probe_above ? upper_gap : lower_gap)))
+        );
+        target = probe_above ? mid_k + step : mid_k - step;
+
+        if (target <= bracket.low.cluster_count || target >= bracket.high.cluster_count) break;
+
+        const PartitionSnapshot& source = top_down
+            ? (probe_above ? bracket.mid : bracket.low)
+            : (probe_above ? bracket.high : bracket.mid);
+
+        restore_snapshot(G, BM, source);
+        run_to(target, true);
+
+        // No progress towards the probe means the bracket cannot narrow further
+        if (BM.cluster_count <= bracket.low.cluster_count ||
+            BM.cluster_count >= bracket.high.cluster_count ||
+            BM.cluster_count == mid_k) {
+            break;
+        }
+
+        update_bracket(bracket, take_snapshot(BM));
+    }
+
+    restore_snapshot(G, BM, bracket.mid);
+}
+
+} // namespace sbp
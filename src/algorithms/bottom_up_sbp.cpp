@@ -1,6 +1,7 @@
-#include "../headers/utils/sbp_utils.hpp"
+#include "../headers/sbp_algorithms.hpp"
 
-#include <unordered_set>
+#include <tuple>
+#include <numeric>
 #include <algorithm>
 
 namespace sbp {
@@ -8,174 +9,313 @@ namespace sbp {
 void bottom_up_sbp(
     utils::Graph& G,
     utils::BlockModel& BM,
-    utils::ClusterCount target_clusters) {
+    utils::ClusterCount target_clusters,
+    const BottomUpOptions& options) {
     
-    // Initialize: each vertex in its own cluster
-    BM = utils::BlockModel(&G, G.get_vertex_count());
-    for (utils::VertexId i = 0; i < static_cast<utils::VertexId>(G.get_vertex_count()); ++i) {
-        BM.cluster_assignment[i] = i;
+    bool resume = options.resume &&
+                  BM.graph == &G &&
+                  BM.cluster_count >= utils::minClusterCount;
+
+    if (!resume) {
+        // Initialize: each vertex in its own cluster
+        BM = utils::BlockModel(&G, G.get_vertex_count());
+        for (utils::VertexId i = 0; i < static_cast<utils::VertexId>(G.get_vertex_count()); ++i) {
+            BM.cluster_assignment[i] = i;
+        }
+        BM.update_matrix();
     }
-    BM.update_matrix();
     
     // Skip initial MCMC refinement - too expensive with N clusters
     // We'll refine after merges when cluster count is manageable
 
+    struct MergeProposal {
+        utils::ClusterId c1, c2;
+        utils::DescriptionLength deltaH;
+    };
+
+    auto log_vertices = std::log(static_cast<utils::Probability>(G.get_vertex_count()));
+
+    // Candidate merges live across rounds. A merge only changes the rows and
+    // columns of the merged cluster and the size seen by its neighbours, so
+    // afterwards only the merged clusters and their block-matrix neighbours
+    // are re-scored; MCMC may touch any cluster, so after it everything is.
+    utils::MergeQueue queue;
+    bool rescore_all = true;
+    utils::ClusterAssignment merged_clusters;
+
+    // Every ΔH reads the same matrix within a round, so its non-zeros are
+    // indexed and each evaluation walks only the pair's entries. The index
+    // follows each contraction and is only rebuilt when rows may have
+    // changed anywhere (the first round and after MCMC).
+    utils::SparseBlockRows sparse;
+
     while (BM.cluster_count > target_clusters) {
-        struct MergeProposal {
-            utils::ClusterId c1, c2;
-            utils::DescriptionLength deltaH;
-        };
-        
-        std::vector<MergeProposal> proposals;
         bool forced_merge = false;  // Track if we're doing a forced merge
         
-        // Parallel merge proposal collection (EDIST Algorithm 4, lines 3-14)
-        #pragma omp parallel
-        {
-            std::vector<MergeProposal> local_proposals;
-            
-            #pragma omp for schedule(dynamic)
-            for (utils::ClusterId c = 0; 
-                 c < static_cast<utils::ClusterId>(BM.cluster_count); 
-                 ++c) {
-                
-                if (BM.clusters_sizes[c] == 0) continue;
-                
-                utils::DescriptionLength best_deltaH = utils::inf;
-                utils::ClusterId best_merge_partner = utils::nullCluster;
-                
-                // Find best merge partner for cluster c
-                for (utils::ClusterId c_prime = 0; 
-                     c_prime < static_cast<utils::ClusterId>(BM.cluster_count); 
-                     ++c_prime) {
-                    
-                    if (c == c_prime || BM.clusters_sizes[c_prime] == 0) continue;
-                    
-                    // Only consider merging clusters that have edges between them
-                    if (BM.block_matrix[c][c_prime] == 0 && 
-                        BM.block_matrix[c_prime][c] == 0) continue;
-                    
-                    // Calculate MDL-based ΔH (EDIST Algorithm 4, line 9)
-                    utils::DescriptionLength deltaH = utils::compute_delta_H_merge(BM, c, c_prime);
-                    
-                    if (deltaH < best_deltaH) {
-                        best_deltaH = deltaH;
-                        best_merge_partner = c_prime;
+        utils::ClusterCount cluster_count = BM.cluster_count;
+        int thread_count = omp_get_max_threads();
+
+        // Clusters whose queued merges are out of date
+        std::vector<char> stale(cluster_count, 0);
+        utils::ClusterAssignment stale_clusters;
+        auto mark_stale = [&](utils::ClusterId c) {
+            if (stale[c] == 0 && BM.clusters_sizes[c] != 0) {
+                stale[c] = 1;
+                stale_clusters.push_back(c);
+            }
+        };
+
+        // Pairs killed on the side of a partner that is not re-scored
+        std::vector<std::pair<utils::ClusterId, utils::ClusterId>> killed;
+
+        if (rescore_all) {
+            sparse.build(BM);
+            queue.invalidate_all(cluster_count);
+            for (utils::ClusterId c = 0; c < static_cast<utils::ClusterId>(cluster_count); ++c) {
+                mark_stale(c);
+            }
+        } else {
+            for (auto merged : merged_clusters) {
+                mark_stale(merged);
+                for (std::size_t idx = sparse.rows.begin(merged); idx < sparse.rows.end(merged); ++idx) {
+                    mark_stale(sparse.rows.clusters[idx]);
+                }
+                if (sparse.directed) {
+                    for (std::size_t idx = sparse.columns.begin(merged); idx < sparse.columns.end(merged); ++idx) {
+                        mark_stale(sparse.columns.clusters[idx]);
                     }
                 }
-                
-                // Store best merge for this cluster (Algorithm 4, line 11)
-                if (best_merge_partner != utils::nullCluster && best_deltaH < 0) {
-                    local_proposals.push_back({c, best_merge_partner, best_deltaH});
+            }
+            killed = queue.invalidate(stale_clusters);
+        }
+
+        // Partners worth scoring for c: every cluster it shares edges with
+        // (row and column non-zeros), or in sampled mode a few of them drawn
+        // with probability proportional to the edges between them
+        auto candidate_partners = [&BM, &sparse, &options](utils::ClusterId c, utils::ClusterAssignment& partners,
+                                                           std::vector<utils::EdgeCount>& cumulative) {
+            partners.clear();
+            for (std::size_t idx = sparse.rows.begin(c); idx < sparse.rows.end(c); ++idx) {
+                partners.push_back(sparse.rows.clusters[idx]);
+            }
+            if (sparse.directed) {
+                for (std::size_t idx = sparse.columns.begin(c); idx < sparse.columns.end(c); ++idx) {
+                    partners.push_back(sparse.columns.clusters[idx]);
                 }
+                std::ranges::sort(partners);
+                partners.erase(std::unique(partners.begin(), partners.end()), partners.end());
             }
-            
-            // Combine results from all threads (simulates MPI_Allgather)
-            #pragma omp critical
-            {
-                proposals.insert(proposals.end(), 
-                                local_proposals.begin(), 
-                                local_proposals.end());
+            std::erase(partners, c);
+
+            if (!options.sampled_merges || partners.size() <= utils::mergeCandidateSamples) return;
+
+            utils::EdgeCount total = 0;
+            cumulative.clear();
+            for (auto c_prime : partners) {
+                total += BM.block_matrix[c][c_prime] + BM.block_matrix[c_prime][c];
+                cumulative.push_back(total);
             }
-        }
 
-        // If no beneficial merges found but we're still above target,
-        // force the least-bad merge to make progress
-        if (proposals.empty() && BM.cluster_count > target_clusters) {
-            // Find the single best merge (even if ΔH ≥ 0)
-            utils::DescriptionLength best_deltaH = utils::inf;
-            utils::ClusterId best_c1 = utils::nullCluster;
-            utils::ClusterId best_c2 = utils::nullCluster;
-            
-            for (utils::ClusterId c1 = 0; c1 < static_cast<utils::ClusterId>(BM.cluster_count); ++c1) {
-                if (BM.clusters_sizes[c1] == 0) continue;
-                
-                for (utils::ClusterId c2 = c1 + 1; c2 < static_cast<utils::ClusterId>(BM.cluster_count); ++c2) {
-                    if (BM.clusters_sizes[c2] == 0) continue;
-                    
-                    // Consider all cluster pairs (not just connected ones) to ensure progress
-                    utils::DescriptionLength deltaH = utils::compute_delta_H_merge(BM, c1, c2);
-                    if (deltaH < best_deltaH) {
-                        best_deltaH = deltaH;
-                        best_c1 = c1;
-                        best_c2 = c2;
-                    }
+            std::uniform_int_distribution<utils::EdgeCount> draw(0, total - 1);
+            utils::ClusterAssignment sampled;
+            for (utils::IterationCount sample = 0; sample < utils::mergeCandidateSamples; ++sample) {
+                auto c_prime = partners[std::ranges::upper_bound(
+                    cumulative, draw(utils::RandomNumerGenerator::get_generator())
+                ) - cumulative.begin()];
+                if (std::ranges::find(sampled, c_prime) == sampled.end()) sampled.push_back(c_prime);
+            }
+            partners = std::move(sampled);
+        };
+
+        // Partner lists of the stale clusters, drawn once per cluster. With
+        // full candidate lists a pair of two stale clusters is kept once,
+        // from its lower id, so each pair is scored once.
+        std::vector<utils::ClusterAssignment> stale_partners(cluster_count);
+        #pragma omp parallel
+        {
+            std::vector<utils::EdgeCount> cumulative;
+
+            #pragma omp for schedule(dynamic, OMP_CHUNK_SIZE)
+            for (std::size_t idx = 0; idx < stale_clusters.size(); ++idx) {
+                auto c = stale_clusters[idx];
+                auto& partners = stale_partners[c];
+                candidate_partners(c, partners, cumulative);
+                if (!options.sampled_merges) {
+                    std::erase_if(partners, [&stale, c](utils::ClusterId c_prime) {
+                        return stale[c_prime] != 0 && c_prime < c;
+                    });
                 }
             }
-            
-            // Add the best merge found (even if ΔH ≥ 0)
-            if (best_c1 != utils::nullCluster && best_c2 != utils::nullCluster) {
-                proposals.push_back({best_c1, best_c2, best_deltaH});
-                forced_merge = true;  // Mark that this is a forced merge
+        }
+
+        // A sampled list need not hold the partners whose entries with c
+        // were just killed, and those partners are not re-scored themselves,
+        // so their pairs are scored again from c (full lists already do)
+        if (options.sampled_merges) {
+            for (const auto& [partner, c] : killed) {
+                stale_partners[c].push_back(partner);
+            }
+            for (auto c : stale_clusters) {
+                auto& partners = stale_partners[c];
+                std::ranges::sort(partners);
+                partners.erase(std::unique(partners.begin(), partners.end()), partners.end());
             }
         }
 
-        if (proposals.empty()) break;
-        
-        // Sort by ΔH (best merges first - EDIST Algorithm 4, line 16)
-        std::sort(proposals.begin(), proposals.end(),
-                  [](const MergeProposal& a, const MergeProposal& b) {
-                      return a.deltaH < b.deltaH;
-                  });
-        
-        // Select independent merges to prevent conflicts (batch merge strategy)
-        std::vector<MergeProposal> independent_merges;
-        std::unordered_set<utils::ClusterId> used_clusters;
-        
+        // Re-score the stale clusters' merges (EDIST Algorithm 4, lines 3-14).
+        // A cluster's partner list is its extent and each partner costs the
+        // two rows' non-zeros, so a hub cluster is cut into slices of its
+        // list and the plan runs largest slice first.
+        auto row_non_zeros = [&sparse](utils::ClusterId c) {
+            return sparse.rows.end(c) - sparse.rows.begin(c);
+        };
+        std::vector<std::size_t> rescore_costs(cluster_count, 0);
+        std::vector<std::size_t> rescore_extents(cluster_count, 0);
+        for (auto c : stale_clusters) {
+            rescore_extents[c] = stale_partners[c].size();
+            for (auto c_prime : stale_partners[c]) {
+                rescore_costs[c] += 1 + row_non_zeros(c) + row_non_zeros(c_prime);
+            }
+        }
+        auto rescore_plan = utils::plan_cluster_work(rescore_costs, rescore_extents, thread_count);
+
+        std::vector<std::vector<utils::MergeCandidate>> rescored(rescore_plan.size());
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (std::size_t idx = 0; idx < rescore_plan.size(); ++idx) {
+            const auto& slice = rescore_plan[idx];
+            const auto& partners = stale_partners[slice.cluster];
+
+            for (std::size_t position = slice.first; position < slice.last; ++position) {
+                utils::MergeCandidate candidate;
+                candidate.key = utils::compute_delta_H_merge(BM, sparse, slice.cluster, partners[position]) +
+                                static_cast<utils::DescriptionLength>(cluster_count) * log_vertices;
+                candidate.c1 = slice.cluster;
+                candidate.c2 = partners[position];
+                rescored[idx].push_back(candidate);
+            }
+        }
+
+        for (const auto& batch : rescored) {
+            for (const auto& candidate : batch) {
+                queue.push(candidate.key, candidate.c1, candidate.c2);
+            }
+        }
+
+        // ΔH of a queued merge at the current cluster count
+        auto complexity = static_cast<utils::DescriptionLength>(cluster_count) * log_vertices;
+
         // Limit merges to not overshoot target
         utils::ClusterCount clusters_to_remove = BM.cluster_count - target_clusters;
         utils::ClusterCount max_merges = std::min(
             static_cast<utils::ClusterCount>(BM.cluster_count * utils::mergeBatchSizeFactor),
             clusters_to_remove  // Don't merge more than needed to reach target
         );
-        
-        for (const auto& proposal : proposals) {
-            // Check if either cluster is already involved in a merge
-            if (used_clusters.find(proposal.c1) == used_clusters.end() &&
-                used_clusters.find(proposal.c2) == used_clusters.end()) {
-                
-                independent_merges.push_back(proposal);
-                used_clusters.insert(proposal.c1);
-                used_clusters.insert(proposal.c2);
-                
-                // Stop when we've selected enough merges (configurable batch size)
-                if (independent_merges.size() >= max_merges) break;
+
+        // Select independent merges best first (EDIST Algorithm 4, line 16)
+        // among the proposals "best merge of either cluster", with the
+        // deterministic parallel greedy selector
+        auto proposals = queue.best_per_cluster(cluster_count, complexity);
+        auto selected = utils::select_independent_merges(
+            proposals, cluster_count, std::max<utils::ClusterCount>(max_merges, 1)
+        );
+
+        std::vector<MergeProposal> independent_merges;
+        for (auto idx : selected) {
+            independent_merges.push_back({proposals[idx].c1, proposals[idx].c2, proposals[idx].key - complexity});
+        }
+
+        // If no beneficial merges found but we're still above target,
+        // force the least-bad merge to make progress. The queue only holds
+        // pairs that share an edge, while a pair with no edges between them
+        // (isolated vertices, small components) can be the cheapest merge,
+        // so the best merge is searched over all pairs c1 < c2. Row c1 spans
+        // the K - c1 - 1 partners above it, so its slices index from c1 + 1.
+        if (independent_merges.empty()) {
+            auto better = [](const MergeProposal& a, const MergeProposal& b) {
+                return a.deltaH < b.deltaH ||
+                       (a.deltaH == b.deltaH && std::tie(a.c1, a.c2) < std::tie(b.c1, b.c2));
+            };
+
+            // Best partner of `c` among [first, last), ties to the lower id
+            auto scan_partners = [&BM, &sparse](utils::ClusterId c, std::size_t first, std::size_t last) {
+                MergeProposal best_partner{c, utils::nullCluster, utils::inf};
+                for (auto c_prime = static_cast<utils::ClusterId>(first);
+                     c_prime < static_cast<utils::ClusterId>(last);
+                     ++c_prime) {
+
+                    if (c == c_prime || BM.clusters_sizes[c_prime] == 0) continue;
+
+                    utils::DescriptionLength deltaH = utils::compute_delta_H_merge(BM, sparse, c, c_prime);
+                    if (deltaH < best_partner.deltaH) {
+                        best_partner.deltaH = deltaH;
+                        best_partner.c2 = c_prime;
+                    }
+                }
+                return best_partner;
+            };
+
+            std::vector<std::size_t> pair_extents(cluster_count, 0);
+            for (utils::ClusterId c1 = 0; c1 < static_cast<utils::ClusterId>(cluster_count); ++c1) {
+                if (BM.clusters_sizes[c1] != 0) pair_extents[c1] = cluster_count - c1 - 1;
+            }
+            const auto& pair_costs = pair_extents;
+            auto pair_plan = utils::plan_cluster_work(pair_costs, pair_extents, thread_count);
+
+            std::vector<MergeProposal> pair_best(pair_plan.size());
+            #pragma omp parallel for schedule(dynamic, 1)
+            for (std::size_t idx = 0; idx < pair_plan.size(); ++idx) {
+                const auto& slice = pair_plan[idx];
+                std::size_t offset = slice.cluster + 1;
+                pair_best[idx] = scan_partners(slice.cluster, offset + slice.first, offset + slice.last);
+            }
+
+            MergeProposal forced{utils::nullCluster, utils::nullCluster, utils::inf};
+            for (const auto& candidate : pair_best) {
+                if (candidate.c2 != utils::nullCluster && better(candidate, forced)) {
+                    forced = candidate;
+                }
+            }
+
+            // Add the best merge found (even if ΔH ≥ 0)
+            if (forced.c2 != utils::nullCluster) {
+                independent_merges.push_back(forced);
+                forced_merge = true;
             }
         }
+
+        if (independent_merges.empty()) break;
         
-        // Apply all independent merges (EDIST Algorithm 4, lines 18-19)
+        // Apply all independent merges (EDIST Algorithm 4, lines 18-19).
+        // The batch is a set of disjoint pairs, so one relabel table maps
+        // every c2 onto its c1 with no chains to resolve; compaction then
+        // numbers the surviving clusters from their sizes in O(K), and the
+        // block model is contracted through the table without an edge pass.
+        utils::ClusterAssignment old_to_new(BM.cluster_count);
+        std::iota(old_to_new.begin(), old_to_new.end(), 0);
         for (const auto& merge : independent_merges) {
-            // Merge cluster c2 into c1
-            for (utils::ClusterId& assign : BM.cluster_assignment) {
-                if (assign == merge.c2) assign = merge.c1;
-            }
+            old_to_new[merge.c2] = merge.c1;  // Merge cluster c2 into c1
         }
 
-        // Renumber clusters to eliminate gaps (optimized version)
-        utils::ClusterAssignment old_to_new(BM.cluster_count, utils::nullCluster);
+        utils::ClusterAssignment compact(BM.cluster_count, utils::nullCluster);
         utils::ClusterCount current_idx = 0;
-        
         for (utils::ClusterId c = 0; c < static_cast<utils::ClusterId>(BM.cluster_count); ++c) {
-            // Check if cluster c is used
-            bool used = std::any_of(
-                BM.cluster_assignment.begin(),
-                BM.cluster_assignment.end(),
-                [c](utils::ClusterId assign) { return assign == c; }
-            );
-            if (used) old_to_new[c] = current_idx++;
+            if (BM.clusters_sizes[c] > 0 && old_to_new[c] == c) compact[c] = current_idx++;
         }
-        
-        // Remap all assignments
-        for (utils::ClusterId& assign : BM.cluster_assignment) {
-            assign = old_to_new[assign];
+        for (auto& target : old_to_new) {
+            target = compact[target];
         }
-        
-        // Update blockmodel structure
-        BM.cluster_count = current_idx;
-        BM.block_matrix.assign(BM.cluster_count, 
-                               std::vector<utils::EdgeCount>(BM.cluster_count, 0));
-        BM.clusters_sizes.assign(BM.cluster_count, 0);
-        BM.update_matrix();
+
+        BM.contract(old_to_new, current_idx);
+        sparse.contract(old_to_new, current_idx);
+
+        // Queued merges follow the renumbering; next round re-scores the
+        // merged clusters and their neighbours
+        queue.relabel(old_to_new, current_idx);
+        merged_clusters.clear();
+        for (const auto& merge : independent_merges) {
+            merged_clusters.push_back(old_to_new[merge.c1]);
+        }
+        rescore_all = false;
         
         // Adaptive MCMC refinement based on cluster count and merge type
         // More refinement for: 1) forced merges, 2) when close to target, 3) fewer clusters
@@ -202,6 +342,7 @@ void bottom_up_sbp(
             }
             
             utils::mcmc_refine(BM, base_iters);
+            rescore_all = true;
         }
         
         // Only break if we've reached target (not if we somehow went below)
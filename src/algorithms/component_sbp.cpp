@@ -0,0 +1,197 @@
+#include "../headers/sbp_algorithms.hpp"
+
+#include <numeric>
+
+namespace sbp {
+
+// Every component keeps at least one cluster; the remaining budget is
+// shared in proportion to the arcs each component stores (largest
+// remainder), never giving a component more clusters than it has vertices.
+// Arcs rather than vertices, so a pool of isolated vertices, which no split
+// can improve, does not claim clusters.
+std::vector<utils::ClusterCount> allocate_component_budgets(
+    const std::vector<utils::SubGraph>& components,
+    utils::ClusterCount max_clusters) {
+
+    utils::ClusterCount component_count = components.size();
+    std::vector<utils::ClusterCount> budgets(component_count, utils::minClusterCount);
+
+    std::vector<utils::EdgeCount> arcs(component_count, 0);
+    utils::EdgeCount splittable_arcs = 0;
+    for (utils::ClusterId c = 0; c < static_cast<utils::ClusterId>(component_count); ++c) {
+        for (utils::VertexId local = 0; local < static_cast<utils::VertexId>(components[c].get_vertex_count()); ++local) {
+            for ([[maybe_unused]] auto neighbor : components[c].neighbors(local)) ++arcs[c];
+        }
+        if (components[c].get_vertex_count() >= utils::binarySplitCount) {
+            splittable_arcs += arcs[c];
+        }
+    }
+
+    if (max_clusters <= component_count || splittable_arcs == 0) {
+        return budgets;
+    }
+
+    utils::ClusterCount extra = max_clusters - component_count;
+    utils::ClusterCount assigned = 0;
+    std::vector<std::pair<utils::Probability, utils::ClusterId>> remainders;
+
+    for (utils::ClusterId c = 0; c < static_cast<utils::ClusterId>(component_count); ++c) {
+        utils::VertexCount size = components[c].get_vertex_count();
+        if (size < utils::binarySplitCount || arcs[c] == 0) continue;
+
+        utils::Probability share = static_cast<utils::Probability>(extra) *
+            static_cast<utils::Probability>(arcs[c]) /
+            static_cast<utils::Probability>(splittable_arcs);
+        auto whole = std::min(
+            static_cast<utils::ClusterCount>(share),
+            size - utils::minClusterCount
+        );
+
+        budgets[c] += whole;
+        assigned += whole;
+        remainders.emplace_back(share - static_cast<utils::Probability>(whole), c);
+    }
+
+    std::ranges::sort(remainders, [](const auto& a, const auto& b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    });
+
+    for (const auto& [remainder, c] : remainders) {
+        if (assigned >= extra) break;
+        if (budgets[c] >= components[c].get_vertex_count()) continue;
+        ++budgets[c];
+        ++assigned;
+    }
+
+    return budgets;
+}
+
+void component_sbp(
+    utils::Graph& G,
+    utils::BlockModel& BM,
+    utils::ClusterCount max_clusters,
+    const SbpRunner& runner) {
+
+    utils::ClusterAssignment component_labels;
+    utils::ClusterCount component_count = utils::connected_components(G, component_labels);
+    utils::VertexCount vertex_count = G.get_vertex_count();
+
+    if (component_count <= utils::minClusterCount) {
+        runner(G, BM, max_clusters);
+        return;
+    }
+
+    // One cluster per component is exactly the budget: nothing to search
+    if (component_count == max_clusters) {
+        BM = utils::BlockModel(&G, component_count);
+        BM.cluster_assignment = std::move(component_labels);
+        BM.update_matrix();
+        return;
+    }
+
+    // A component whose proportional share of the budget is below one
+    // cluster cannot have a cluster of its own; all such components are
+    // pooled into one remainder unit that is clustered as a whole. At most
+    // max_clusters components can reach a full share, so the units (large
+    // components plus the remainder) always fit the budget.
+    std::vector<utils::VertexCount> component_sizes(component_count, 0);
+    for (auto label : component_labels) {
+        ++component_sizes[label];
+    }
+
+    std::vector<utils::ClusterId> unit_of_component(component_count, utils::nullCluster);
+    utils::ClusterCount unit_count = 0;
+    for (utils::ClusterId c = 0; c < static_cast<utils::ClusterId>(component_count); ++c) {
+        if (component_sizes[c] * max_clusters >= vertex_count) {
+            unit_of_component[c] = static_cast<utils::ClusterId>(unit_count++);
+        }
+    }
+    if (unit_count < component_count) {
+        for (auto& unit : unit_of_component) {
+            if (unit == utils::nullCluster) unit = static_cast<utils::ClusterId>(unit_count);
+        }
+        ++unit_count;
+    }
+
+    // Nothing to separate once small components are pooled
+    if (unit_count <= utils::minClusterCount) {
+        runner(G, BM, max_clusters);
+        return;
+    }
+
+    for (auto& label : component_labels) {
+        label = unit_of_component[label];
+    }
+    component_count = unit_count;
+
+    utils::VertexMapping global_to_local;
+    std::vector<utils::SubGraph> components;
+    utils::build_subgraph_views(G, component_labels, component_count, global_to_local, components);
+
+    auto budgets = allocate_component_budgets(components, max_clusters);
+
+    // Components with a single-cluster budget need no clustering run
+    std::vector<utils::ClusterId> runnable;
+    for (utils::ClusterId c = 0; c < static_cast<utils::ClusterId>(component_count); ++c) {
+        if (budgets[c] > utils::minClusterCount) {
+            runnable.push_back(c);
+        }
+    }
+
+    std::vector<utils::ClusterAssignment> local_assignments(component_count);
+    std::vector<utils::ClusterCount> local_cluster_counts(budgets);
+    std::vector<double> local_mcmc_times(component_count, 0.0);
+
+    auto run_component = [&](utils::ClusterId c) {
+        utils::Graph component_graph = components[c].materialize();
+        utils::BlockModel component_bm;
+        runner(component_graph, component_bm, budgets[c]);
+
+        local_assignments[c] = std::move(component_bm.cluster_assignment);
+        local_cluster_counts[c] = component_bm.cluster_count;
+        local_mcmc_times[c] = component_bm.total_mcmc_time;
+    };
+
+    // With fewer components than threads each run keeps its inner parallelism
+    if (static_cast<int>(runnable.size()) < omp_get_max_threads()) {
+        for (auto c : runnable) {
+            run_component(c);
+        }
+    } else {
+        // Largest components first, so a big one never starts last
+        std::vector<std::size_t> costs(component_count, 0);
+        std::vector<std::size_t> extents(component_count, 1);
+        for (auto c : runnable) {
+            costs[c] = components[c].get_vertex_count();
+        }
+        auto plan = utils::plan_cluster_work(costs, extents, omp_get_max_threads());
+
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (std::size_t idx = 0; idx < plan.size(); ++idx) {
+            run_component(plan[idx].cluster);
+        }
+    }
+
+    // Stitch: each component's clusters get a contiguous range of ids
+    std::vector<utils::ClusterId> cluster_offsets(component_count, 0);
+    utils::ClusterCount total_clusters = 0;
+    for (utils::ClusterId c = 0; c < static_cast<utils::ClusterId>(component_count); ++c) {
+        cluster_offsets[c] = static_cast<utils::ClusterId>(total_clusters);
+        total_clusters += local_assignments[c].empty()
+            ? utils::minClusterCount
+            : local_cluster_counts[c];
+    }
+
+    BM = utils::BlockModel(&G, total_clusters);
+    for (utils::ClusterId c = 0; c < static_cast<utils::ClusterId>(component_count); ++c) {
+        const auto& members = components[c].subgraph_mapping;
+        for (utils::VertexId local = 0; local < static_cast<utils::VertexId>(members.size()); ++local) {
+            utils::ClusterId local_cluster = local_assignments[c].empty() ? 0 : local_assignments[c][local];
+            BM.cluster_assignment[members[local]] = cluster_offsets[c] + local_cluster;
+        }
+    }
+    BM.update_matrix();
+    BM.total_mcmc_time = std::accumulate(local_mcmc_times.begin(), local_mcmc_times.end(), 0.0);
+}
+
+} // namespace sbp
@@ -0,0 +1,84 @@
+#include "../headers/sbp_algorithms.hpp"
+
+namespace sbp {
+
+// Majority cluster among already-assigned neighbours (either direction);
+// nullCluster if none of them is assigned yet
+utils::ClusterId majority_neighbor_cluster(
+    const utils::Graph& G,
+    const utils::ClusterAssignment& assignment,
+    utils::ClusterCount cluster_count,
+    utils::VertexId vertex) {
+
+    utils::WeightMap votes;
+    for (auto neighbor : G.neighbors(vertex)) {
+        if (assignment[neighbor] != utils::nullCluster) ++votes[assignment[neighbor]];
+    }
+    for (auto neighbor : G.in_neighbors(vertex)) {
+        if (assignment[neighbor] != utils::nullCluster) ++votes[assignment[neighbor]];
+    }
+
+    utils::ClusterId best_cluster = utils::nullCluster;
+    utils::EdgeCount best_votes = 0;
+    for (const auto& [cluster, count] : votes) {
+        if (cluster < static_cast<utils::ClusterId>(cluster_count) && count > best_votes) {
+            best_votes = count;
+            best_cluster = cluster;
+        }
+    }
+    return best_cluster;
+}
+
+void pruned_sbp(
+    utils::Graph& G,
+    utils::BlockModel& BM,
+    utils::ClusterCount max_clusters,
+    const SbpRunner& runner,
+    utils::VertexCount min_degree,
+    bool iterate) {
+
+    utils::VertexList peel_order;
+    utils::ClusterAssignment core_labels = utils::peel_low_degree(G, min_degree, iterate, peel_order);
+
+    utils::VertexCount core_size = G.get_vertex_count() - peel_order.size();
+    if (peel_order.empty() || core_size < max_clusters) {
+        runner(G, BM, max_clusters);
+        return;
+    }
+
+    utils::VertexMapping global_to_local;
+    std::vector<utils::SubGraph> core_views;
+    utils::build_subgraph_views(G, core_labels, utils::minClusterCount, global_to_local, core_views);
+
+    utils::Graph core_graph = core_views[0].materialize();
+    utils::BlockModel core_bm;
+    runner(core_graph, core_bm, max_clusters);
+
+    BM = utils::BlockModel(&G, core_bm.cluster_count);
+    BM.total_mcmc_time = core_bm.total_mcmc_time;
+
+    const auto& core_members = core_views[0].subgraph_mapping;
+    for (utils::VertexId local = 0; local < static_cast<utils::VertexId>(core_members.size()); ++local) {
+        BM.cluster_assignment[core_members[local]] = core_bm.cluster_assignment[local];
+    }
+
+    // Largest core cluster takes vertices with no assigned neighbour at all
+    utils::ClusterId fallback_cluster = static_cast<utils::ClusterId>(std::distance(
+        core_bm.clusters_sizes.begin(),
+        std::ranges::max_element(core_bm.clusters_sizes)
+    ));
+
+    // Reverse peel order: every neighbour a vertex still had when it was
+    // peeled is either core or peeled later, so it is assigned by now
+    for (auto it = peel_order.rbegin(); it != peel_order.rend(); ++it) {
+        utils::ClusterId cluster = majority_neighbor_cluster(G, BM.cluster_assignment, BM.cluster_count, *it);
+        BM.cluster_assignment[*it] = (cluster == utils::nullCluster) ? fallback_cluster : cluster;
+    }
+
+    BM.update_matrix();
+
+    // Local refinement of the reattached vertices only
+    utils::mcmc_refine_vertices(BM, peel_order, utils::reattachMcmcMultiplier * peel_order.size());
+}
+
+} // namespace sbp
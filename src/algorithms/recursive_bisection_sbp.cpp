@@ -0,0 +1,156 @@
+#include "../headers/sbp_algorithms.hpp"
+
+#include <array>
+#include <numeric>
+
+namespace sbp {
+
+// One cluster of the bisection tree: its induced graph, the original ids of
+// its vertices (ascending, since views keep vertex order) and the most
+// leaves its subtree may produce
+struct BisectionNode {
+    utils::Graph graph;
+    utils::VertexList members;
+    utils::ClusterCount budget{utils::minClusterCount};
+};
+
+// Shared state of one recursive_bisection_sbp run
+struct BisectionTree {
+    utils::ProposalCount proposals_per_split{0};
+    std::vector<utils::VertexList> leaves;
+};
+
+// Best bisection of a cluster, kept only if its two-block H beats the H of
+// the cluster left whole. Children get their own compact graphs and share
+// the budget in proportion to their size, so a capped run needs no
+// coordination between subtrees.
+bool bisect_node(
+    const utils::Graph& graph,
+    const utils::VertexList& members,
+    utils::ClusterCount budget,
+    utils::ProposalCount proposals_per_split,
+    std::array<BisectionNode, utils::binarySplitCount>& children) {
+
+    utils::VertexCount vertex_count = graph.get_vertex_count();
+    if (vertex_count < utils::binarySplitCount || budget < utils::binarySplitCount) {
+        return false;
+    }
+
+    utils::ClusterAssignment whole(vertex_count, 0);
+    utils::VertexMapping global_to_local;
+    std::vector<utils::SubGraph> views;
+    utils::build_subgraph_views(graph, whole, utils::minClusterCount, global_to_local, views);
+
+    SplitResult split = connectivity_snowball_split(views[0], proposals_per_split);
+
+    // Every stored arc is internal to the cluster
+    utils::EdgeCount internal_edges = 0;
+    for (utils::VertexId vertex = 0; vertex < static_cast<utils::VertexId>(vertex_count); ++vertex) {
+        internal_edges += graph.degree(vertex);
+    }
+    if (split.h >= utils::compute_single_block_H(internal_edges, vertex_count)) {
+        return false;
+    }
+
+    utils::build_subgraph_views(graph, split.assignment, utils::binarySplitCount, global_to_local, views);
+    for (std::size_t side = 0; side < utils::binarySplitCount; ++side) {
+        // A one-sided split cannot lower H, but guard the view anyway
+        if (views[side].get_vertex_count() == 0) {
+            return false;
+        }
+    }
+
+    for (std::size_t side = 0; side < utils::binarySplitCount; ++side) {
+        children[side].graph = views[side].materialize();
+        children[side].members.clear();
+        for (auto local : views[side].subgraph_mapping) {
+            children[side].members.push_back(members[local]);
+        }
+    }
+
+    auto first_budget = static_cast<utils::ClusterCount>(std::round(
+        static_cast<utils::Probability>(budget) *
+        static_cast<utils::Probability>(children[0].members.size()) /
+        static_cast<utils::Probability>(vertex_count)
+    ));
+    children[0].budget = std::clamp<utils::ClusterCount>(first_budget, 1, budget - 1);
+    children[1].budget = budget - children[0].budget;
+    return true;
+}
+
+void record_leaf(BisectionTree& tree, utils::VertexList&& members) {
+    #pragma omp critical (bisection_leaves)
+    tree.leaves.push_back(std::move(members));
+}
+
+// Each child subtree is its own task; the node's graph is released before
+// descending, so live memory follows the open frontier of the tree
+void bisect_subtree(BisectionNode node, BisectionTree& tree) {
+    std::array<BisectionNode, utils::binarySplitCount> children;
+
+    if (!bisect_node(node.graph, node.members, node.budget, tree.proposals_per_split, children)) {
+        record_leaf(tree, std::move(node.members));
+        return;
+    }
+    node = BisectionNode{};
+
+    for (std::size_t side = 0; side < utils::binarySplitCount; ++side) {
+        #pragma omp task default(none) firstprivate(side) shared(children, tree)
+        bisect_subtree(std::move(children[side]), tree);
+    }
+    #pragma omp taskwait
+}
+
+void recursive_bisection_sbp(
+    utils::Graph& G,
+    utils::BlockModel& BM,
+    utils::ClusterCount max_clusters,
+    utils::ProposalCount proposals_per_split,
+    bool global_refinement) {
+
+    utils::VertexCount vertex_count = G.get_vertex_count();
+
+    BisectionTree tree;
+    tree.proposals_per_split = proposals_per_split;
+
+    utils::VertexList all_vertices(vertex_count);
+    std::iota(all_vertices.begin(), all_vertices.end(), 0);
+
+    // The root split runs before the task tree so its proposals still use
+    // every thread; below it, each subtree search runs inside one task
+    std::array<BisectionNode, utils::binarySplitCount> children;
+    utils::ClusterCount budget = (max_clusters == 0 || max_clusters > vertex_count) ? vertex_count : max_clusters;
+    if (!bisect_node(G, all_vertices, budget, proposals_per_split, children)) {
+        tree.leaves.push_back(std::move(all_vertices));
+    } else {
+        all_vertices.clear();
+
+        #pragma omp parallel default(none) shared(children, tree)
+        #pragma omp single
+        {
+            for (std::size_t side = 0; side < utils::binarySplitCount; ++side) {
+                #pragma omp task default(none) firstprivate(side) shared(children, tree)
+                bisect_subtree(std::move(children[side]), tree);
+            }
+        }
+    }
+
+    // Leaves are numbered by their smallest vertex, independent of task order
+    std::ranges::sort(tree.leaves, [](const utils::VertexList& a, const utils::VertexList& b) {
+        return a.front() < b.front();
+    });
+
+    BM = utils::BlockModel(&G, tree.leaves.size());
+    for (utils::ClusterId cluster = 0; cluster < static_cast<utils::ClusterId>(tree.leaves.size()); ++cluster) {
+        for (auto vertex : tree.leaves[cluster]) {
+            BM.cluster_assignment[vertex] = cluster;
+        }
+    }
+    BM.update_matrix();
+
+    if (global_refinement) {
+        utils::mcmc_refine(BM, utils::mcmcRefinementMultiplier * vertex_count);
+    }
+}
+
+} // namespace sbp
@@ -1,217 +1,489 @@
-#include "../headers/utils/sbp_utils.hpp"
+#include "../headers/sbp_algorithms.hpp"
 
-#include <unordered_map>
+#include <numeric>
 
 namespace sbp {
 
-utils::BlockModel connectivity_snowball_split( // NOLINT
-    utils::SubGraph& subgraph, 
-    utils::IterationCount iteration_proposal) {
+// Whether the proposer runs snowballs on a cluster of this size
+bool uses_snowball(utils::SplitProposer proposer, utils::VertexCount vertex_count) {
+    return proposer == utils::SplitProposer::Snowball ||
+           (proposer == utils::SplitProposer::Mixed && vertex_count < utils::mixedProposerMinVertices);
+}
+
+// Proposals for a cluster of this size. proposals_per_split is the snowball
+// budget; Mixed mode hands large clusters to spectral and label propagation,
+// which need only a handful.
+utils::ProposalCount cluster_proposal_budget(
+    utils::SplitProposer proposer,
+    utils::VertexCount vertex_count,
+    utils::ProposalCount proposals_per_split,
+    bool adaptive) {
+
+    utils::ProposalCount budget = adaptive
+        ? utils::adaptive_proposal_budget(vertex_count, proposals_per_split)
+        : proposals_per_split;
+    if (proposer == utils::SplitProposer::Mixed && !uses_snowball(proposer, vertex_count)) {
+        budget = std::min(budget, utils::mixedLargeClusterProposals);
+    }
+    return budget;
+}
+
+SplitResult connectivity_snowball_split( // NOLINT
+    const utils::SubGraph& subgraph,
+    utils::IterationCount iteration_proposal,
+    utils::SplitProposer proposer,
+    bool adaptive) {
 
-    if (subgraph.graph.get_vertex_count() < utils::binarySplitCount) {
-        utils::BlockModel bm(&(subgraph.graph), utils::minClusterCount);
+    if (subgraph.get_vertex_count() < utils::binarySplitCount) {
         // Initialize all vertices to cluster 0
-        std::fill(bm.cluster_assignment.begin(), bm.cluster_assignment.end(), 0);
-        return bm;
+        utils::ClusterAssignment single(subgraph.get_vertex_count(), 0);
+        auto model = utils::count_split_blocks(subgraph, single);
+        return {
+            std::move(single),
+            utils::compute_single_block_H(model.block_matrix[0][0], subgraph.get_vertex_count())
+        };
     }
 
-    utils::BlockModel best_bm;
-    utils::DescriptionLength best_h = 
-        std::numeric_limits<utils::DescriptionLength>::max();
+    SplitResult best;
+    utils::ProposalStopping stopping;
+    bool stopped = false;
+
+    iteration_proposal = cluster_proposal_budget(proposer, subgraph.get_vertex_count(), iteration_proposal, adaptive);
+
+    // Built once and shared read-only by every proposal's snowball
+    utils::DenseSplitGraph dense;
+    if (uses_snowball(proposer, subgraph.get_vertex_count())) {
+        dense.build(subgraph);
+    }
 
     #pragma omp parallel
     {
-        utils::BlockModel local_best_bm;
-        utils::DescriptionLength local_best_h = 
-            std::numeric_limits<utils::DescriptionLength>::max();
+        auto& scratch = utils::SplitScratch::local();
+        utils::DescriptionLength local_best_h = utils::inf;
 
-        #pragma omp for
-        for (utils::IterationCount iteration = 0; 
-            iteration < iteration_proposal; 
+        #pragma omp for schedule(dynamic, 1)
+        for (utils::IterationCount iteration = 0;
+            iteration < iteration_proposal;
             ++iteration) {
 
-            utils::BlockModel current_bm(&(subgraph.graph), utils::binarySplitCount);
-            utils::VertexCount vertex_count = subgraph.graph.get_vertex_count();
-
-            // Select two random seed vertices for binary split
-            utils::VertexId seed1 = utils::RandomNumerGenerator::random_int(
-                0, static_cast<int>(vertex_count) - 1
-            );
-
-            utils::VertexId seed2 = utils::RandomNumerGenerator::random_int(
-                0, static_cast<int>(vertex_count) - 1
-            );
+            bool skip = false;
+            #pragma omp atomic read
+            skip = stopped;
+            if (skip) continue;
+
+            utils::DescriptionLength h = utils::split_proposal( //NOLINT
+                subgraph, proposer, iteration, scratch, &dense
+            ).compute_H();
+
+            if (adaptive) {
+                #pragma omp critical (snowball_stopping)
+                {
+                    if (!stopped && stopping.record(1, h, h, 0.0)) {
+                        #pragma omp atomic write
+                        stopped = true;
+                    }
+                }
+            }
 
-            while (seed2 == seed1) {
-                seed2 = utils::RandomNumerGenerator::random_int(
-                    0, static_cast<int>(vertex_count) - 1
-                );
+            if (h < local_best_h) {
+                local_best_h = h;
+                std::swap(scratch.best_assignment, scratch.assignment);
             }
+        }
 
-            utils::ClusterAssignment assignment(vertex_count, utils::nullCluster);
+        #pragma omp critical
+        {
+            if (local_best_h < best.h) {
+                best.h = local_best_h;
+                best.assignment = scratch.best_assignment;
+            }
+        }
+    }
 
-            assignment[seed1] = 0;
-            assignment[seed2] = 1;
+    return best;
+}
 
-            // Collect unassigned vertices
-            utils::VertexList unassigned_vec;
-            for (utils::VertexId i = 0; i < static_cast<utils::VertexId>(vertex_count); ++i) {
-                if (assignment[i] == utils::nullCluster) {
-                    unassigned_vec.push_back(i);
-                }
-            }
+// Best split found so far for one cluster. Ties on H go to the lowest
+// proposal index, so the reduction over evaluated proposals does not depend
+// on task completion order; the proposals themselves draw from per-thread
+// generators, so which thread runs one still changes its split.
+// Entries double as the split cache across top-down iterations: a result
+// stays valid while the cluster's membership fingerprint is unchanged.
+struct ClusterSplitSearch {
+    SplitResult best;
+    utils::ProposalCount best_proposal{0};
+    utils::Fingerprint fingerprint{0};
+    bool searched{false};
+    utils::ProposalStopping stopping;
+    bool stopped{false};
+};
+
+// Evaluates every (cluster, proposal) pair as one pool of work. The pool is
+// an LPT plan over clusters (cost = vertices x proposals): small clusters
+// keep all their proposals in one slice, large ones are cut into proposal
+// ranges, and slices run largest-first so no big cluster starts last.
+void search_splits_parallel(
+    const std::vector<utils::SubGraph>& subgraphs,
+    utils::ProposalCount proposals_per_split,
+    utils::SplitProposer proposer,
+    bool adaptive,
+    const std::vector<utils::ClusterId>& clusters_to_search,
+    std::vector<ClusterSplitSearch>& searches) {
+
+    std::vector<std::size_t> costs(subgraphs.size(), 0);
+    std::vector<std::size_t> extents(subgraphs.size(), 0);
+
+    for (auto cluster : clusters_to_search) {
+        auto fingerprint = searches[cluster].fingerprint;
+        searches[cluster] = ClusterSplitSearch{};
+        searches[cluster].fingerprint = fingerprint;
+        searches[cluster].searched = true;
+
+        utils::VertexCount vertex_count = subgraphs[cluster].get_vertex_count();
+        if (vertex_count < utils::binarySplitCount) {
+            continue;
+        }
 
-            std::shuffle(
-                unassigned_vec.begin(), 
-                unassigned_vec.end(), 
-                utils::RandomNumerGenerator::get_generator()
-            );
+        extents[cluster] = cluster_proposal_budget(proposer, vertex_count, proposals_per_split, adaptive);
+        costs[cluster] = vertex_count * extents[cluster];
+    }
 
-            for (utils::VertexId vertex : unassigned_vec) {
-                utils::EdgeScore score0 = 0; 
-                utils::EdgeScore score1 = 0;
+    // Small dense clusters get their bit matrix built once for all of their
+    // proposals; the build is indivisible, so it gets an extent-1 plan
+    std::vector<utils::DenseSplitGraph> dense(subgraphs.size());
+    std::vector<std::size_t> build_costs(subgraphs.size(), 0);
+    std::vector<std::size_t> build_extents(subgraphs.size(), 1);
+    for (auto cluster : clusters_to_search) {
+        utils::VertexCount vertex_count = subgraphs[cluster].get_vertex_count();
+        if (vertex_count >= utils::denseSnowballMinVertices &&
+            vertex_count <= utils::denseSnowballMaxVertices &&
+            uses_snowball(proposer, vertex_count)) {
+            build_costs[cluster] = vertex_count;
+        }
+    }
+    auto build_plan = utils::plan_cluster_work(build_costs, build_extents, omp_get_max_threads());
 
-                for (utils::VertexId neighbor : 
-                                    subgraph.graph.adjacency_list[vertex]) {
+    #pragma omp parallel for schedule(dynamic, 1) default(none) shared(build_plan, subgraphs, dense)
+    for (std::size_t idx = 0; idx < build_plan.size(); ++idx) {
+        auto cluster = build_plan[idx].cluster;
+        dense[cluster].build(subgraphs[cluster]);
+    }
 
-                    if (assignment[neighbor] == 0) {
-                        ++score0;
-                    } else if (assignment[neighbor] == 1) {
-                        ++score1;
-                    }
-                }
-                
-                if (score0 > score1) {
-                    assignment[vertex] = 0;
-                } else if (score1 > score0) {
-                    assignment[vertex] = 1;
-                } else {
-                    assignment[vertex] = 
-                        utils::RandomNumerGenerator::random_int(0, 1);
+    auto plan = utils::plan_cluster_work(costs, extents, omp_get_max_threads());
+
+    #pragma omp parallel for schedule(dynamic, 1) default(none) \
+                             shared(plan, subgraphs, searches, dense) firstprivate(proposer, adaptive)
+    for (std::size_t idx = 0; idx < plan.size(); ++idx) {
+        auto cluster = plan[idx].cluster;
+        auto first = static_cast<utils::ProposalCount>(plan[idx].first);
+        auto last = static_cast<utils::ProposalCount>(plan[idx].last);
+
+        // Per-thread buffers; the best assignment is swapped, not copied
+        auto& scratch = utils::SplitScratch::local();
+        utils::DescriptionLength local_best_h = utils::inf;
+        utils::ProposalCount local_best_proposal = first;
+
+        // Welford statistics of the proposals since the last fold. Folding
+        // every few proposals lets a cluster searched in a single slice
+        // stop part way through its budget, not only after it.
+        utils::ProposalCount evaluated = 0;
+        utils::DescriptionLength batch_best_h = utils::inf;
+        utils::Probability mean_h = 0.0;
+        utils::Probability m2_h = 0.0;
+
+        auto fold_statistics = [&]() {
+            #pragma omp critical (split_search_stopping)
+            {
+                auto& search = searches[cluster];
+                // Stopping is sticky: slices already running still report
+                if (!search.stopped && search.stopping.record(evaluated, batch_best_h, mean_h, m2_h)) {
+                    #pragma omp atomic write
+                    search.stopped = true;
                 }
             }
+            evaluated = 0;
+            batch_best_h = utils::inf;
+            mean_h = 0.0;
+            m2_h = 0.0;
+        };
 
-            current_bm.cluster_assignment = std::move(assignment);
-            current_bm.update_matrix();
+        for (utils::ProposalCount proposal = first; proposal < last; ++proposal) {
+            bool skip = false;
+            #pragma omp atomic read
+            skip = searches[cluster].stopped;
+            if (skip) break;
 
-            utils::DescriptionLength h = utils::compute_H(current_bm); //NOLINT
+            utils::DescriptionLength h = utils::split_proposal( //NOLINT
+                subgraphs[cluster], proposer, proposal, scratch, &dense[cluster]
+            ).compute_H();
+
+            ++evaluated;
+            batch_best_h = std::min(batch_best_h, h);
+            utils::Probability delta = h - mean_h;
+            mean_h += delta / static_cast<utils::Probability>(evaluated);
+            m2_h += delta * (h - mean_h);
 
             if (h < local_best_h) {
                 local_best_h = h;
-                local_best_bm = current_bm;
+                local_best_proposal = proposal;
+                std::swap(scratch.best_assignment, scratch.assignment);
+            }
+
+            if (adaptive && evaluated >= utils::proposalFoldInterval) {
+                fold_statistics();
             }
         }
 
-        #pragma omp critical
+        if (adaptive && evaluated > 0) {
+            fold_statistics();
+        }
+
+        #pragma omp critical (split_search_best)
         {
-            if (local_best_h < best_h) {
-                best_h = local_best_h;
-                best_bm = std::move(local_best_bm);
+            auto& search = searches[cluster];
+            if (local_best_h < search.best.h ||
+                (local_best_h == search.best.h && local_best_proposal < search.best_proposal)) {
+                search.best.h = local_best_h;
+                search.best_proposal = local_best_proposal;
+                std::swap(search.best.assignment, scratch.best_assignment);
             }
         }
     }
-
-    return best_bm;
 }
 
-void extract_subgraphs_parallel(
-    const utils::BlockModel& block_model, 
-    std::vector<utils::SubGraph>& subgraphs)  {
+// Split search for a very large cluster: proposals are scored on a random
+// induced sample, then the winning sample split seeds one snowball pass
+// over the whole cluster
+SplitResult sampled_split_search(
+    const utils::SubGraph& cluster,
+    utils::ProposalCount proposals_per_split,
+    const TopDownOptions& options) {
+
+    utils::VertexCount vertex_count = cluster.get_vertex_count();
+    auto sample_size = std::max(
+        utils::sampledSplitMinSample,
+        static_cast<utils::VertexCount>(utils::sampledSplitFraction * static_cast<utils::Probability>(vertex_count))
+    );
+
+    utils::VertexList sample(vertex_count);
+    std::iota(sample.begin(), sample.end(), 0);
+    std::shuffle(sample.begin(), sample.end(), utils::RandomNumerGenerator::get_generator());
+    sample.resize(std::min(sample_size, vertex_count));
+
+    utils::VertexMapping sample_index;
+    utils::Graph sample_graph = cluster.materialize_sample(sample, sample_index);
+
+    utils::ClusterAssignment whole(sample.size(), 0);
+    utils::VertexMapping global_to_local;
+    std::vector<utils::SubGraph> views;
+    utils::build_subgraph_views(sample_graph, whole, utils::minClusterCount, global_to_local, views);
+
+    SplitResult sample_split = connectivity_snowball_split(
+        views[0], proposals_per_split, options.split_proposer, options.adaptive_proposals
+    );
+
+    SplitResult result;
+    result.assignment.assign(vertex_count, utils::nullCluster);
+    for (utils::VertexId idx = 0; idx < static_cast<utils::VertexId>(sample.size()); ++idx) {
+        result.assignment[sample[idx]] = sample_split.assignment[idx];
+    }
 
-    subgraphs.clear();
-    subgraphs.resize(block_model.cluster_count);
-    
-    std::vector<utils::VertexList> cluster_members(block_model.cluster_count);
-    for (utils::VertexId i = 0; 
-         i < static_cast<utils::VertexId>(block_model.cluster_assignment.size());
-         ++i) {
+    utils::VertexList order;
+    result.h = utils::snowball_extend(cluster, result.assignment, order).compute_H();
+    return result;
+}
 
-        cluster_members[
-            block_model.cluster_assignment[i]
-        ].push_back(i);
+// FM local search on the best split of every freshly searched cluster, so
+// acceptance sees the refined H. Each refinement is indivisible, so the LPT
+// plan only orders clusters largest-first.
+void refine_best_splits(
+    const std::vector<utils::SubGraph>& subgraphs,
+    const std::vector<utils::ClusterId>& clusters_to_search,
+    std::vector<ClusterSplitSearch>& searches) {
+
+    std::vector<std::size_t> costs(subgraphs.size(), 0);
+    std::vector<std::size_t> extents(subgraphs.size(), 1);
+    for (auto cluster : clusters_to_search) {
+        if (searches[cluster].best.h < utils::inf) {
+            costs[cluster] = subgraphs[cluster].get_vertex_count();
+        }
     }
 
-    #pragma omp parallel for
-    for (utils::ClusterId cluster = 0; 
-         cluster < static_cast<utils::ClusterId>(block_model.cluster_count); 
-        ++cluster) {
+    auto plan = utils::plan_cluster_work(costs, extents, omp_get_max_threads());
 
-        utils::SubGraph& sub = subgraphs[cluster];
-        sub.subgraph_mapping = std::move(cluster_members[cluster]);
+    #pragma omp parallel for schedule(dynamic, 1) default(none) shared(plan, subgraphs, searches)
+    for (std::size_t idx = 0; idx < plan.size(); ++idx) {
+        auto& best = searches[plan[idx].cluster].best;
+        best.h = utils::fm_refine_split(
+            subgraphs[plan[idx].cluster], best.assignment, utils::SplitScratch::local().fm
+        ).compute_H();
+    }
+}
 
-        utils::VertexCount n_sub = sub.subgraph_mapping.size();
-        sub.graph.adjacency_list.resize(n_sub);
-        
-        std::unordered_map<utils::VertexId, utils::VertexId> global_to_local;
-        for (utils::VertexId i = 0; 
-             i < static_cast<utils::VertexId>(n_sub); 
-              ++i) {
+// Re-points the views of clusters whose membership changed; the others are
+// still exact. A cluster whose member set is unchanged but reordered (a
+// vertex moved out and back) keeps its cached split, carried over to the
+// new local ids.
+void refresh_subgraphs(
+    const utils::BlockModel& block_model,
+    utils::ClusterMembership& membership,
+    std::vector<utils::SubGraph>& subgraphs,
+    std::vector<ClusterSplitSearch>& searches) {
 
-            global_to_local[sub.subgraph_mapping[i]] = i;
+    subgraphs.resize(block_model.cluster_count);
+    searches.resize(block_model.cluster_count);
+
+    // Copying a member list costs its length; largest clusters go first
+    std::vector<std::size_t> costs(block_model.cluster_count, 0);
+    std::vector<std::size_t> extents(block_model.cluster_count, 1);
+    for (utils::ClusterId i = 0; i < static_cast<utils::ClusterId>(block_model.cluster_count); ++i) {
+        if (membership.dirty[i]) {
+            costs[i] = membership.members[i].size() + 1;
         }
+    }
+    auto plan = utils::plan_cluster_work(costs, extents, omp_get_max_threads());
+
+    #pragma omp parallel for schedule(dynamic, 1) default(none) shared(plan, block_model, membership, subgraphs, searches)
+    for (std::size_t idx = 0; idx < plan.size(); ++idx) {
+        auto i = plan[idx].cluster;
+        utils::VertexMapping previous_members = std::move(subgraphs[i].subgraph_mapping);
+        membership.refresh_view(*block_model.graph, block_model.cluster_assignment, i, subgraphs[i]);
+
+        auto& search = searches[i];
+        if (search.searched && search.fingerprint == membership.fingerprints[i] &&
+            search.best.assignment.size() == previous_members.size()) {
+            utils::ClusterAssignment carried(previous_members.size());
+            for (std::size_t local = 0; local < previous_members.size(); ++local) {
+                carried[membership.position[previous_members[local]]] = search.best.assignment[local];
+            }
+            search.best.assignment = std::move(carried);
+        }
+    }
 
-        for (utils::VertexId i = 0; 
-             i < static_cast<utils::VertexId>(n_sub); 
-             ++i) {
-
-            utils::VertexId u_global = sub.subgraph_mapping[i];
+    // std::vector<bool> packs flags into shared words, so clear them serially
+    for (const auto& slice : plan) {
+        membership.dirty[slice.cluster] = false;
+    }
+}
 
-            for (utils::VertexId v_global : 
-                        block_model.graph->adjacency_list[u_global]) {
+// Members of the split clusters plus their out/in neighbours elsewhere.
+// in_region is all false on entry and reset before returning.
+void collect_split_region(
+    const utils::Graph& graph,
+    const std::vector<utils::SubGraph>& subgraphs,
+    const std::vector<utils::ClusterId>& split_clusters,
+    std::vector<bool>& in_region,
+    utils::VertexList& region) {
+
+    region.clear();
+    auto add = [&](utils::VertexId vertex) {
+        if (!in_region[vertex]) {
+            in_region[vertex] = true;
+            region.push_back(vertex);
+        }
+    };
 
-                if (block_model.cluster_assignment[v_global] == cluster) {
-                    sub.graph.adjacency_list[i].push_back(global_to_local[v_global]);
-                }
-            }
+    for (auto cluster : split_clusters) {
+        for (auto vertex : subgraphs[cluster].subgraph_mapping) {
+            add(vertex);
         }
     }
+
+    // Boundary: scan only the members, not the vertices just added
+    utils::VertexCount member_count = region.size();
+    for (utils::VertexCount idx = 0; idx < member_count; ++idx) {
+        utils::VertexId vertex = region[idx];
+        for (auto neighbor : graph.neighbors(vertex)) add(neighbor);
+        for (auto neighbor : graph.in_neighbors(vertex)) add(neighbor);
+    }
+
+    for (auto vertex : region) {
+        in_region[vertex] = false;
+    }
 }
 
 void top_down_sbp(
-    utils::Graph& graph, 
-    utils::BlockModel& block_model, 
-    utils::ClusterCount max_clusters, 
-    utils::IterationCount proposals_per_split) {
-    
-    block_model = utils::BlockModel(&graph, utils::minClusterCount);
-    // Initialize all vertices to cluster 0
-    std::fill(block_model.cluster_assignment.begin(), block_model.cluster_assignment.end(), 0);
-    block_model.update_matrix();
+    utils::Graph& graph,
+    utils::BlockModel& block_model,
+    utils::ClusterCount max_clusters,
+    utils::IterationCount proposals_per_split,
+    const TopDownOptions& options) {
+
+    bool resume = options.resume &&
+                  block_model.graph == &graph &&
+                  block_model.cluster_count >= utils::minClusterCount;
+
+    if (!resume) {
+        block_model = utils::BlockModel(&graph, utils::minClusterCount);
+        // Initialize all vertices to cluster 0
+        std::fill(block_model.cluster_assignment.begin(), block_model.cluster_assignment.end(), 0);
+        block_model.update_matrix();
+    }
+
+    // Built once; afterwards only split and MCMC moves touch it
+    utils::ClusterMembership membership;
+    membership.build(block_model.cluster_assignment, block_model.cluster_count);
+
+    std::vector<utils::SubGraph> subgraphs;
+    std::vector<ClusterSplitSearch> searches;
+    std::vector<bool> in_region(graph.get_vertex_count(), false);
+    utils::VertexList region;
+    utils::VertexList moved_vertices;
 
     while (block_model.cluster_count < max_clusters) {
-        std::vector<utils::SubGraph> subgraphs;
-        extract_subgraphs_parallel(block_model, subgraphs);
+        refresh_subgraphs(block_model, membership, subgraphs, searches);
+
+        // Only clusters whose membership changed since their last search
+        // (the split pair, new clusters, MCMC-touched ones) are searched again
+        std::vector<utils::ClusterId> clusters_to_search;
+        for (utils::ClusterId i = 0; i < static_cast<utils::ClusterId>(block_model.cluster_count); ++i) {
+            utils::Fingerprint fingerprint = membership.fingerprints[i];
+            if (!searches[i].searched || searches[i].fingerprint != fingerprint) {
+                searches[i].fingerprint = fingerprint;
+                clusters_to_search.push_back(i);
+            }
+        }
+
+        // Very large clusters are searched one at a time on a sample (each
+        // search is parallel inside); the rest share the task pool
+        std::vector<utils::ClusterId> clusters_to_pool;
+        for (auto cluster : clusters_to_search) {
+            if (options.sampled_split_search &&
+                subgraphs[cluster].get_vertex_count() >= utils::sampledSplitMinVertices) {
+                searches[cluster].best = sampled_split_search(subgraphs[cluster], proposals_per_split, options);
+                searches[cluster].searched = true;
+            } else {
+                clusters_to_pool.push_back(cluster);
+            }
+        }
+
+        search_splits_parallel(subgraphs, proposals_per_split, options.split_proposer,
+                               options.adaptive_proposals, clusters_to_pool, searches);
+        if (options.refine_splits) {
+            refine_best_splits(subgraphs, clusters_to_search, searches);
+        }
 
         struct SplitCandidate {
             utils::DescriptionLength deltaH;
             utils::ClusterId cluster_idx;
-            utils::BlockModel split_bm;
         };
         std::vector<SplitCandidate> candidates;
 
         for (utils::ClusterId i = 0; i < static_cast<utils::ClusterId>(block_model.cluster_count); ++i) {
-            if (subgraphs[i].graph.get_vertex_count() < utils::binarySplitCount) {
+            if (subgraphs[i].get_vertex_count() < utils::binarySplitCount) {
                 continue;
             }
-            
-            // Calculate H for 1-cluster blockmodel of subgraph
-            utils::BlockModel single_bm(&(subgraphs[i].graph), utils::minClusterCount);
-            std::fill(single_bm.cluster_assignment.begin(), single_bm.cluster_assignment.end(), 0);
-            single_bm.update_matrix();
-            utils::DescriptionLength h_before = utils::compute_H(single_bm);
-            
-            // Get best 2-cluster split
-            utils::BlockModel split = connectivity_snowball_split(subgraphs[i], proposals_per_split);
-            utils::DescriptionLength h_after = utils::compute_H(split);
-            
+
+            // Closed form from the cluster's internal arcs, no subgraph pass
+            utils::DescriptionLength h_before = utils::compute_single_block_H(
+                block_model.block_matrix[i][i], block_model.clusters_sizes[i]
+            );
+            utils::DescriptionLength h_after = searches[i].best.h;
+
             // Accept splits that reduce H or are within a tolerance (less conservative)
             utils::ToleranceFactor tolerance = utils::splitToleranceFactor * std::abs(h_before);
             if (h_after < h_before + tolerance) {
-                SplitCandidate sc; // NOLINT
-                sc.deltaH = h_after - h_before;
-                sc.cluster_idx = i;
-                sc.split_bm = std::move(split);
-                candidates.push_back(std::move(sc));
+                candidates.push_back({h_after - h_before, i});
             }
         }
 
@@ -219,34 +491,75 @@ void top_down_sbp(
             break;
         }
 
-        // Find best split (minimum deltaH)
-        auto best_it = std::ranges::min_element(candidates,
-                            [](const SplitCandidate& a, const SplitCandidate& b) { // NOLINT
-                                return a.deltaH < b.deltaH;
-                            });
-    
-        auto& best = *best_it;
-        auto new_cluster_id = static_cast<utils::ClusterId>(block_model.cluster_count);
-        utils::SubGraph& sub = subgraphs[best.cluster_idx];
-        
-        block_model.cluster_count++;
+        // Best splits first (minimum deltaH, ties to the lower cluster id)
+        std::ranges::sort(candidates,
+                          [](const SplitCandidate& a, const SplitCandidate& b) { // NOLINT
+                              return a.deltaH < b.deltaH ||
+                                     (a.deltaH == b.deltaH && a.cluster_idx < b.cluster_idx);
+                          });
+
+        // Each candidate is a different cluster, so any prefix is non-overlapping
+        utils::ClusterCount splits_this_round = std::min<utils::ClusterCount>({
+            std::max<utils::ClusterCount>(
+                1,
+                static_cast<utils::ClusterCount>(options.split_batch_fraction * block_model.cluster_count)
+            ),
+            max_clusters - block_model.cluster_count,
+            candidates.size()
+        });
+
+        utils::ClusterCount new_cluster_count = block_model.cluster_count + splits_this_round;
         // Resize B matrix: first resize outer dimension, then resize each row
-        block_model.block_matrix.resize(block_model.cluster_count);
+        block_model.block_matrix.resize(new_cluster_count);
         for (auto& row : block_model.block_matrix) {
-            row.resize(block_model.cluster_count, 0);
+            row.resize(new_cluster_count, 0);
         }
-        block_model.clusters_sizes.resize(block_model.cluster_count, 0);
+        block_model.clusters_sizes.resize(new_cluster_count, 0);
+
+        for (utils::ClusterCount split = 0; split < splits_this_round; ++split) {
+            const auto& best = candidates[split];
+            auto new_cluster_id = static_cast<utils::ClusterId>(block_model.cluster_count + split);
+            const utils::VertexMapping& members = subgraphs[best.cluster_idx].subgraph_mapping;
+            const utils::ClusterAssignment& split_assignment = searches[best.cluster_idx].best.assignment;
 
-        for (utils::VertexId i = 0; i < static_cast<utils::VertexId>(sub.graph.get_vertex_count()); ++i) {
-            if (best.split_bm.cluster_assignment[i] == 1) {
-                block_model.cluster_assignment[sub.subgraph_mapping[i]] = new_cluster_id;
+            for (utils::VertexId i = 0; i < static_cast<utils::VertexId>(members.size()); ++i) {
+                if (split_assignment[i] == 1) {
+                    block_model.cluster_assignment[members[i]] = new_cluster_id;
+                }
+            }
+        }
+        block_model.cluster_count = new_cluster_count;
+
+        membership.resize(new_cluster_count);
+        for (utils::ClusterCount split = 0; split < splits_this_round; ++split) {
+            for (auto vertex : subgraphs[candidates[split].cluster_idx].subgraph_mapping) {
+                membership.sync(vertex, block_model.cluster_assignment[vertex]);
             }
         }
-        
+
         block_model.update_matrix();
-        
-        // Apply MCMC refinement after each split (reduced for stability)
-        utils::mcmc_refine(block_model, utils::mcmcRefinementMultiplier * block_model.graph->get_vertex_count());
+
+        moved_vertices.clear();
+        block_model.move_log = &moved_vertices;
+
+        if (options.local_refinement) {
+            // Only the split clusters and vertices bordering them can gain
+            // from a move, so the budget follows that region's size
+            std::vector<utils::ClusterId> split_clusters;
+            for (utils::ClusterCount split = 0; split < splits_this_round; ++split) {
+                split_clusters.push_back(candidates[split].cluster_idx);
+            }
+            collect_split_region(graph, subgraphs, split_clusters, in_region, region);
+            utils::mcmc_refine_vertices(block_model, region, utils::mcmcRefinementMultiplier * region.size());
+        } else {
+            // Apply MCMC refinement once per round of splits (reduced for stability)
+            utils::mcmc_refine(block_model, utils::mcmcRefinementMultiplier * block_model.graph->get_vertex_count());
+        }
+
+        block_model.move_log = nullptr;
+        for (auto vertex : moved_vertices) {
+            membership.sync(vertex, block_model.cluster_assignment[vertex]);
+        }
     }
 }
 
@@ -1,4 +1,4 @@
-#include "headers/utils/sbp_utils.hpp"
+#include "headers/sbp_algorithms.hpp"
 #include "headers/graph_generation.hpp"
 
 #include <chrono>
@@ -12,11 +12,6 @@
 
 using namespace sbp;
 
-namespace sbp {
-    void top_down_sbp(utils::Graph&, utils::BlockModel&, utils::ClusterCount, utils::ProposalCount);
-    void bottom_up_sbp(utils::Graph&, utils::BlockModel&, utils::ClusterCount);
-}
-
 struct BenchmarkResult {
     int graph_id;
     int num_vertices;
@@ -44,7 +39,13 @@ BenchmarkResult run_single_benchmark(
     const std::string& algorithm,
     const std::string& execution_mode,
     int run_num,
-    utils::ProposalCount proposals_per_split) 
+    utils::ProposalCount proposals_per_split,
+    bool split_components,
+    bool prune_low_degree,
+    bool auto_k,
+    bool recursive_bisection,
+    const sbp::TopDownOptions& top_down_options,
+    const sbp::BottomUpOptions& bottom_up_options) 
 {
     BenchmarkResult result;
     result.graph_id = graph_id;
@@ -60,11 +61,40 @@ BenchmarkResult run_single_benchmark(
     // Measure runtime
     auto start = std::chrono::high_resolution_clock::now();
     
-    if (algorithm == "TopDown") {
-        sbp::top_down_sbp(G, bm, target_k, proposals_per_split);
+    sbp::SbpRunner runner;
+    if (auto_k) {
+        // The cluster budget is ignored: the MDL search picks K itself
+        auto sbp_algorithm = (algorithm == "TopDown") ? sbp::SbpAlgorithm::TopDown : sbp::SbpAlgorithm::BottomUp;
+        runner = [sbp_algorithm, proposals_per_split, top_down_options, bottom_up_options](utils::Graph& graph, utils::BlockModel& block_model, utils::ClusterCount) {
+            sbp::auto_k_sbp(graph, block_model, sbp_algorithm, proposals_per_split, 0, top_down_options, bottom_up_options);
+        };
+    } else if (algorithm == "TopDown" && recursive_bisection) {
+        runner = [proposals_per_split](utils::Graph& graph, utils::BlockModel& block_model, utils::ClusterCount k) {
+            sbp::recursive_bisection_sbp(graph, block_model, k, proposals_per_split);
+        };
+    } else if (algorithm == "TopDown") {
+        runner = [proposals_per_split, top_down_options](utils::Graph& graph, utils::BlockModel& block_model, utils::ClusterCount k) {
+            sbp::top_down_sbp(graph, block_model, k, proposals_per_split, top_down_options);
+        };
     } else {
-        sbp::bottom_up_sbp(G, bm, target_k);
+        runner = [bottom_up_options](utils::Graph& graph, utils::BlockModel& block_model, utils::ClusterCount k) {
+            sbp::bottom_up_sbp(graph, block_model, k, bottom_up_options);
+        };
+    }
+
+    // Optional pre-passes wrap the algorithm: pruning outermost, then components
+    if (split_components) {
+        runner = [inner = runner](utils::Graph& graph, utils::BlockModel& block_model, utils::ClusterCount k) {
+            sbp::component_sbp(graph, block_model, k, inner);
+        };
     }
+    if (prune_low_degree) {
+        runner = [inner = runner](utils::Graph& graph, utils::BlockModel& block_model, utils::ClusterCount k) {
+            sbp::pruned_sbp(graph, block_model, k, inner);
+        };
+    }
+
+    runner(G, bm, target_k);
     
     auto end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> elapsed = end - start;
@@ -106,6 +136,15 @@ void append_result_to_csv(std::ofstream& csv, const BenchmarkResult& result) {
     csv.flush(); // Flush after each write so we can see progress
 }
 
+const char* split_proposer_name(utils::SplitProposer proposer) {
+    switch (proposer) {
+        case utils::SplitProposer::Spectral: return "spectral";
+        case utils::SplitProposer::LabelPropagation: return "label propagation";
+        case utils::SplitProposer::Mixed: return "mixed by cluster size";
+        default: return "snowball";
+    }
+}
+
 int main(int argc, char* argv[]) {
     GraphGenerationMethod graphGenerationMethod = GraphGenerationMethod::STANDARD;
     std::string execution_mode = "parallel"; // default to parallel
@@ -126,6 +165,44 @@ int main(int argc, char* argv[]) {
         // For "parallel" mode, use default (all available threads)
     }
 
+    // Optional trailing flags:
+    //   "compressed" stores adjacency as varint gaps
+    //   "components" clusters each connected component independently
+    //   "prune" peels degree-0/1 vertices and reattaches them afterwards
+    //   "multisplit" lets top-down apply several splits per round
+    //   "localmcmc" refines only split clusters and their boundary in top-down
+    //   "bisection" runs top-down as independent recursive bisection
+    //   "spectral" / "labelprop" / "mixedsplit" choose the split proposer
+    //   "fm" refines each best split with Fiduccia-Mattheyses passes
+    //   "adaptive" scales proposals per split with cluster size, stopping early
+    //   "sampled" searches very large clusters' splits on a vertex sample
+    //   "sampledmerges" draws a few edge-weighted merge partners per cluster
+    //   "autok" ignores the configured K and selects it by MDL
+    bool compress_adjacency = false;
+    bool split_components = false;
+    bool prune_low_degree = false;
+    bool auto_k = false;
+    bool recursive_bisection = false;
+    sbp::TopDownOptions top_down_options;
+    sbp::BottomUpOptions bottom_up_options;
+    for (int i = 3; i < argc; ++i) {
+        std::string flag = argv[i];
+        if (flag == "compressed") compress_adjacency = true;
+        if (flag == "components") split_components = true;
+        if (flag == "prune") prune_low_degree = true;
+        if (flag == "autok") auto_k = true;
+        if (flag == "bisection") recursive_bisection = true;
+        if (flag == "localmcmc") top_down_options.local_refinement = true;
+        if (flag == "spectral") top_down_options.split_proposer = utils::SplitProposer::Spectral;
+        if (flag == "labelprop") top_down_options.split_proposer = utils::SplitProposer::LabelPropagation;
+        if (flag == "fm") top_down_options.refine_splits = true;
+        if (flag == "adaptive") top_down_options.adaptive_proposals = true;
+        if (flag == "sampled") top_down_options.sampled_split_search = true;
+        if (flag == "mixedsplit") top_down_options.split_proposer = utils::SplitProposer::Mixed;
+        if (flag == "sampledmerges") bottom_up_options.sampled_merges = true;
+        if (flag == "multisplit") top_down_options.split_batch_fraction = utils::defaultSplitBatchFraction;
+    }
+
     std::cout << "=== SBP Benchmark Suite ===\n";
     std::cout << "Graphs: 1K, 2K, 5K vertices (5 runs each)\n";
     std::cout << "Algorithms: Top-Down SBP, Bottom-Up SBP\n";
@@ -146,13 +223,34 @@ int main(int argc, char* argv[]) {
         std::cout << "Threads: " << omp_get_max_threads() << "\n";
     }
 
+    std::cout << "Adjacency: " << (compress_adjacency ? "compressed" : "plain") << "\n";
+    std::cout << "Per-component clustering: " << (split_components ? "on" : "off") << "\n";
+    std::cout << "Low-degree pruning: " << (prune_low_degree ? "on" : "off") << "\n";
+    std::cout << "Top-down mode: " << (recursive_bisection ? "recursive bisection" : "global best split") << "\n";
+    std::cout << "Top-down refinement: "
+              << (top_down_options.local_refinement ? "split region" : "whole graph") << "\n";
+    std::cout << "Split proposer: " << split_proposer_name(top_down_options.split_proposer) << "\n";
+    std::cout << "Split refinement: " << (top_down_options.refine_splits ? "FM" : "none") << "\n";
+    std::cout << "Proposals per split: " << (top_down_options.adaptive_proposals ? "adaptive" : "fixed") << "\n";
+    std::cout << "Large-cluster split search: " << (top_down_options.sampled_split_search ? "sampled" : "full") << "\n";
+    std::cout << "Merge candidates: " << (bottom_up_options.sampled_merges ? "sampled" : "all clusters") << "\n";
+    std::cout << "Cluster count: " << (auto_k ? "automatic (MDL)" : "configured") << "\n";
+    std::cout << "Top-down splits per round: "
+              << (top_down_options.split_batch_fraction > 0.0 ? "batched" : "single") << "\n";
+
     std::cout << "Estimated runtime: ~5-10 minutes\n\n";
     
     // Graph configurations (conservative sizes for stability)
     std::vector<GraphConfigBase*> configs = read_graph_configs_from_csv("scripts/graph_config.csv", graphGenerationMethod);
     
     const int NUM_RUNS = 5;
-    const int PROPOSALS_PER_SPLIT = 50;
+    // Spectral and label-propagation proposals are individually much stronger
+    // than a random snowball, so a handful replaces the usual fifty. Mixed
+    // mode still snowballs small clusters: it keeps fifty, and top-down caps
+    // its large clusters at a handful itself.
+    const int PROPOSALS_PER_SPLIT =
+        (top_down_options.split_proposer == utils::SplitProposer::Snowball ||
+         top_down_options.split_proposer == utils::SplitProposer::Mixed) ? 50 : 5;
     
     // Create results directory if it doesn't exist
     std::filesystem::create_directories("results");
@@ -180,17 +278,25 @@ int main(int argc, char* argv[]) {
             int seed = graph_id * 1000 + run;
 
             utils::Graph G = config->generateGraph(true_labels, seed);
+            if (compress_adjacency) {
+                auto plain_bytes = G.adjacency_memory_bytes();
+                G.compress();
+                if (run == 0) {
+                    std::cout << " adjacency " << plain_bytes / 1024 << " KiB -> "
+                              << G.adjacency_memory_bytes() / 1024 << " KiB compressed..." << std::flush;
+                }
+            }
             
             // Run Top-Down
             auto td_result = run_single_benchmark(
                 G, true_labels, graph_id, config->k,
-                "TopDown", execution_mode, run, PROPOSALS_PER_SPLIT);
+                "TopDown", execution_mode, run, PROPOSALS_PER_SPLIT, split_components, prune_low_degree, auto_k, recursive_bisection, top_down_options, bottom_up_options);
             append_result_to_csv(csv, td_result);
             
             // Run Bottom-Up
             auto bu_result = run_single_benchmark(
                 G, true_labels, graph_id, config->k,
-                "BottomUp", execution_mode, run, PROPOSALS_PER_SPLIT);
+                "BottomUp", execution_mode, run, PROPOSALS_PER_SPLIT, split_components, prune_low_degree, auto_k, recursive_bisection, top_down_options, bottom_up_options);
             append_result_to_csv(csv, bu_result);
             
             std::cout << " Done (TD: " << std::fixed << std::setprecision(3)
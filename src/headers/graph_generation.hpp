@@ -34,11 +34,13 @@ public:
 
 struct GraphConfig : public GraphConfigBase {
     double p_in, p_out;
+    bool directed{false};   // Sample each ordered pair independently
 
 public:
     virtual sbp::utils::Graph generateGraph(std::vector<sbp::utils::ClusterId>& true_assignment, int seed) override {
         sbp::utils::Graph G;
         G.adjacency_list.resize(n);
+        G.directed = directed;
 
         true_assignment.resize(n);
         for (int i = 0; i < n; ++i) {
@@ -48,12 +50,27 @@ public:
         std::mt19937 gen(seed);
         std::uniform_real_distribution<> dist(0.0, 1.0);
 
-        for (int i = 0; i < n; ++i) {
-            for (int j = i + 1; j < n; ++j) {
-                double p = (true_assignment[i] == true_assignment[j]) ? p_in : p_out;
-                if (dist(gen) < p) {
-                    G.adjacency_list[i].push_back(j);
-                    G.adjacency_list[j].push_back(i);
+        if (directed) {
+            // Arcs are stored once, in the tail's out-list
+            for (int i = 0; i < n; ++i) {
+                for (int j = 0; j < n; ++j) {
+                    if (i == j) continue;
+                    double p = (true_assignment[i] == true_assignment[j]) ? p_in : p_out;
+                    if (dist(gen) < p) {
+                        G.adjacency_list[i].push_back(j);
+                    }
+                }
+            }
+            G.build_in_adjacency();
+        }
+        else {
+            for (int i = 0; i < n; ++i) {
+                for (int j = i + 1; j < n; ++j) {
+                    double p = (true_assignment[i] == true_assignment[j]) ? p_in : p_out;
+                    if (dist(gen) < p) {
+                        G.adjacency_list[i].push_back(j);
+                        G.adjacency_list[j].push_back(i);
+                    }
                 }
             }
         }
@@ -221,6 +238,11 @@ std::vector<GraphConfigBase*> read_standard_graph_configs_from_csv(const std::st
             if (!std::getline(ss, token, ',')) continue;
             cfg->p_out = std::stod(token);
 
+            // Parse optional directed flag
+            if (std::getline(ss, token, ',') && !token.empty()) {
+                cfg->directed = std::stoi(token) != 0;
+            }
+
             configs.push_back(cfg);
         }
         catch (const std::invalid_argument& e) {
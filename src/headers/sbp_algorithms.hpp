@@ -0,0 +1,127 @@
+#ifndef SBP_ALGORITHMS_HPP
+#define SBP_ALGORITHMS_HPP
+
+#include "utils/sbp_utils.hpp"
+
+#include <functional>
+
+namespace sbp {
+
+// Clusters a graph into (at most) the given number of clusters
+using SbpRunner = std::function<
+    void(utils::Graph&, utils::BlockModel&, utils::ClusterCount)
+>;
+
+struct SplitResult {
+    utils::ClusterAssignment assignment;  // Local vertex -> 0 / 1
+    utils::DescriptionLength h{utils::inf};
+};
+
+// Best of iteration_proposal bisections of one cluster. Adaptive mode
+// scales the count with the cluster size and stops early once the best H
+// stalls or the proposals' H barely varies; Mixed mode caps the count of
+// clusters too large for snowballs at mixedLargeClusterProposals.
+SplitResult connectivity_snowball_split(
+    const utils::SubGraph& subgraph,
+    utils::IterationCount iteration_proposal,
+    utils::SplitProposer proposer = utils::SplitProposer::Snowball,
+    bool adaptive = false);
+
+struct TopDownOptions {
+    // Fraction of the current cluster count split per round (best
+    // non-overlapping accepted splits first); 0 keeps one split per round
+    utils::Probability split_batch_fraction{0.0};
+
+    // Continue from the partition already in BM (same graph) instead of
+    // restarting from a single cluster
+    bool resume{false};
+
+    // Refine only the split clusters and their boundary neighbours after
+    // each round instead of running MCMC over the whole graph
+    bool local_refinement{false};
+
+    // Generator of binary split proposals
+    utils::SplitProposer split_proposer{utils::SplitProposer::Snowball};
+
+    // Improve each cluster's best split with FM local search before acceptance
+    bool refine_splits{false};
+
+    // Size-scaled proposal budget with early stopping; false keeps exactly
+    // proposals_per_split per cluster
+    bool adaptive_proposals{false};
+
+    // Search clusters of sampledSplitMinVertices or more on a random induced
+    // sample and extend the winner to the whole cluster
+    bool sampled_split_search{false};
+};
+
+void top_down_sbp(
+    utils::Graph& G, 
+    utils::BlockModel& BM, 
+    utils::ClusterCount max_clusters, 
+    utils::ProposalCount proposals_per_split,
+    const TopDownOptions& options = {});
+
+// Bisects every cluster recursively and independently, one OpenMP task per
+// subtree, keeping a split whenever it lowers that cluster's own MDL.
+// max_clusters = 0 means no cap besides N.
+void recursive_bisection_sbp(
+    utils::Graph& G,
+    utils::BlockModel& BM,
+    utils::ClusterCount max_clusters,
+    utils::ProposalCount proposals_per_split,
+    bool global_refinement = true);
+
+struct BottomUpOptions {
+    // Continue merging from the partition already in BM (same graph)
+    // instead of restarting from one cluster per vertex
+    bool resume{false};
+    // Evaluate only mergeCandidateSamples partners per cluster, drawn from
+    // its block-matrix neighbours weighted by edge count, instead of all K
+    bool sampled_merges{false};
+};
+
+void bottom_up_sbp(
+    utils::Graph& G, 
+    utils::BlockModel& BM, 
+    utils::ClusterCount target_clusters,
+    const BottomUpOptions& options = {});
+
+enum class SbpAlgorithm {
+    TopDown, BottomUp
+};
+
+// Chooses the cluster count itself: follows the split (or merge) trajectory,
+// keeps the partitions it passes and narrows a golden-section bracket around
+// the minimum-description-length K. max_clusters = 0 means no cap besides N.
+void auto_k_sbp(
+    utils::Graph& G,
+    utils::BlockModel& BM,
+    SbpAlgorithm algorithm,
+    utils::ProposalCount proposals_per_split,
+    utils::ClusterCount max_clusters = 0,
+    const TopDownOptions& top_down_options = {},
+    const BottomUpOptions& bottom_up_options = {});
+
+// Clusters every connected component independently and stitches the results;
+// components too small for a cluster of their own are pooled and clustered
+// together, and exactly max_clusters components are returned as they are
+void component_sbp(
+    utils::Graph& G,
+    utils::BlockModel& BM,
+    utils::ClusterCount max_clusters,
+    const SbpRunner& runner);
+
+// Peels vertices of degree < min_degree (iteratively if requested), clusters
+// the remaining core and reattaches the peeled vertices to neighbour blocks
+void pruned_sbp(
+    utils::Graph& G,
+    utils::BlockModel& BM,
+    utils::ClusterCount max_clusters,
+    const SbpRunner& runner,
+    utils::VertexCount min_degree = utils::defaultPeelDegree,
+    bool iterate = true);
+
+} // namespace sbp
+
+#endif // SBP_ALGORITHMS_HPP
@@ -34,6 +34,7 @@ using Entropy           = double;
 using DescriptionLength = double;
 using ToleranceFactor   = double; 
 
+using Fingerprint       = std::uint64_t;
 using RandomSeed        = std::uint64_t;
 using RandomGenerator   = std::mt19937_64;
 using MemorySize        = std::size_t;
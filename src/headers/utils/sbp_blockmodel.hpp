@@ -7,6 +7,7 @@
 #include "sbp_aliases.hpp"
 
 #include <omp.h>
+#include <utility>
 #include <algorithm>
 
 #define OMP_CHUNK_SIZE 64
@@ -21,6 +22,7 @@ struct BlockModel {
     ClusterAssignment cluster_assignment;
     ClustersSizes clusters_sizes;
     double total_mcmc_time{0.0};  // Accumulated MCMC refinement time in seconds
+    VertexList* move_log{nullptr}; // When set, MCMC appends every vertex it relocates
 
     BlockModel() = default;
 
@@ -34,6 +36,8 @@ struct BlockModel {
         block_matrix.assign(cluster_count, std::vector<EdgeCount>(cluster_count, 0));
     }
     
+    // Counts every stored arc u -> v into block_matrix[c(u)][c(v)]. Undirected
+    // graphs store both directions, so their matrix comes out symmetric.
     void update_matrix() {
         if (graph == nullptr || cluster_count <= 0) { return; }
 
@@ -62,7 +66,7 @@ struct BlockModel {
                 continue;
             }
 
-            for (auto vertex_v : graph->adjacency_list[vertex_u]) {
+            for (auto vertex_v : graph->neighbors(vertex_u)) {
 
                 if (vertex_v < 0 || 
                     vertex_v >= static_cast<VertexId>(cluster_assignment.size())) {
@@ -104,11 +108,18 @@ struct BlockModel {
                 return;
         }
 
-        if (vertex >= static_cast<VertexId>(graph->adjacency_list.size())) {
+        if (vertex >= static_cast<VertexId>(graph->get_vertex_count())) {
             return;
         }
 
-        for (auto& neighbour : graph->adjacency_list[vertex]) {
+        if (new_cluster < 0 || 
+            new_cluster >= static_cast<ClusterId>(cluster_count)) {
+            return;
+        }
+
+        // Out-edges (all edges if undirected) move row entries; for undirected
+        // graphs the mirrored column entry is updated alongside.
+        for (auto neighbour : graph->neighbors(vertex)) {
             if (neighbour < 0 || 
                 neighbour >= static_cast<VertexId>(cluster_assignment.size())) {
                 continue;
@@ -121,16 +132,33 @@ struct BlockModel {
                 continue;
             }
 
-            if (new_cluster < 0 || 
-                new_cluster >= static_cast<ClusterId>(cluster_count)) {
-                continue;
+            --block_matrix[old_cluster][neighbour_cluster];
+            ++block_matrix[new_cluster][neighbour_cluster];
+
+            if (!graph->directed) {
+                --block_matrix[neighbour_cluster][old_cluster];
+                ++block_matrix[neighbour_cluster][new_cluster];
             }
+        }
 
-            --block_matrix[old_cluster][neighbour_cluster];
-            --block_matrix[neighbour_cluster][old_cluster];
+        // In-edges of a directed graph move column entries only
+        if (graph->directed) {
+            for (auto neighbour : graph->in_neighbors(vertex)) {
+                if (neighbour < 0 || 
+                    neighbour >= static_cast<VertexId>(cluster_assignment.size())) {
+                    continue;
+                }
 
-            ++block_matrix[new_cluster][neighbour_cluster];
-            ++block_matrix[neighbour_cluster][new_cluster];
+                auto neighbour_cluster = cluster_assignment[neighbour];
+
+                if (neighbour_cluster < 0 || 
+                    neighbour_cluster >= static_cast<ClusterId>(cluster_count)) {
+                    continue;
+                }
+
+                --block_matrix[neighbour_cluster][old_cluster];
+                ++block_matrix[neighbour_cluster][new_cluster];
+            }
         }
         
         --clusters_sizes[old_cluster];
@@ -139,8 +167,238 @@ struct BlockModel {
 
     } // move_vertex()
 
+    // Merges clusters through a relabel table (old id -> new id, nullCluster
+    // for clusters that are empty). Block counts and sizes of the new model
+    // are sums of the old ones, so the matrix is contracted in O(K^2) without
+    // touching the edges; only the assignment needs an O(N) pass.
+    void contract(const ClusterAssignment& old_to_new, ClusterCount new_cluster_count) {
+        auto old_count = static_cast<ClusterId>(cluster_count);
+
+        // Old clusters grouped by their new id (counting sort)
+        std::vector<std::size_t> source_offsets(new_cluster_count + 1, 0);
+        for (ClusterId old_cluster = 0; old_cluster < old_count; ++old_cluster) {
+            if (old_to_new[old_cluster] != nullCluster) ++source_offsets[old_to_new[old_cluster] + 1];
+        }
+        for (std::size_t idx = 0; idx < new_cluster_count; ++idx) {
+            source_offsets[idx + 1] += source_offsets[idx];
+        }
+        ClusterAssignment sources(source_offsets[new_cluster_count]);
+        std::vector<std::size_t> fill(source_offsets.begin(), source_offsets.end() - 1);
+        for (ClusterId old_cluster = 0; old_cluster < old_count; ++old_cluster) {
+            if (old_to_new[old_cluster] != nullCluster) sources[fill[old_to_new[old_cluster]]++] = old_cluster;
+        }
+
+        BlockMatrix contracted(new_cluster_count, std::vector<EdgeCount>(new_cluster_count, 0));
+        ClustersSizes contracted_sizes(new_cluster_count, 0);
+
+        // Each new row is written by one thread only
+        #pragma omp parallel for schedule(dynamic, OMP_CHUNK_SIZE) \
+                                default(none) \
+                                shared(old_to_new, source_offsets, sources, contracted, contracted_sizes, \
+                                       block_matrix, clusters_sizes, old_count, new_cluster_count)
+        for (std::size_t new_cluster = 0; new_cluster < new_cluster_count; ++new_cluster) {
+            auto& row = contracted[new_cluster];
+            for (std::size_t idx = source_offsets[new_cluster]; idx < source_offsets[new_cluster + 1]; ++idx) {
+                ClusterId old_cluster = sources[idx];
+                contracted_sizes[new_cluster] += clusters_sizes[old_cluster];
+
+                const auto& old_row = block_matrix[old_cluster];
+                for (ClusterId old_column = 0; old_column < old_count; ++old_column) {
+                    if (old_row[old_column] != 0) {
+                        row[old_to_new[old_column]] += old_row[old_column];
+                    }
+                }
+            }
+        }
+
+        #pragma omp parallel for schedule(static) default(none) shared(old_to_new, cluster_assignment)
+        for (std::size_t vertex = 0; vertex < cluster_assignment.size(); ++vertex) {
+            if (cluster_assignment[vertex] != nullCluster) {
+                cluster_assignment[vertex] = old_to_new[cluster_assignment[vertex]];
+            }
+        }
+
+        cluster_count = new_cluster_count;
+        block_matrix = std::move(contracted);
+        clusters_sizes = std::move(contracted_sizes);
+    } // contract()
+
 }; // BlockModel
 
+// Non-zero entries of each block-matrix row (or column), ascending by
+// cluster id, in one flat array
+struct SparseBlockLines {
+    std::vector<std::size_t> offsets;
+    std::vector<ClusterId> clusters;
+    std::vector<EdgeCount> counts;
+
+    [[nodiscard]] std::size_t begin(ClusterId line) const { return offsets[line]; }
+    [[nodiscard]] std::size_t end(ClusterId line) const { return offsets[line + 1]; }
+
+    // Follows BlockModel::contract through the same relabel table (old id
+    // -> new id, nullCluster for removed clusters) in O(nnz) instead of a
+    // dense rebuild. A line with one source whose ids stay ascending under
+    // the table is copied with renumbered ids; only merged lines and lines
+    // touching a merged cluster are re-sorted and their duplicates summed.
+    void contract(const ClusterAssignment& old_to_new, ClusterCount new_line_count) {
+        auto old_count = static_cast<ClusterId>(offsets.size() - 1);
+
+        // Old lines grouped by their new id (counting sort)
+        std::vector<std::size_t> source_offsets(new_line_count + 1, 0);
+        for (ClusterId old_line = 0; old_line < old_count; ++old_line) {
+            if (old_to_new[old_line] != nullCluster) ++source_offsets[old_to_new[old_line] + 1];
+        }
+        for (std::size_t idx = 0; idx < new_line_count; ++idx) {
+            source_offsets[idx + 1] += source_offsets[idx];
+        }
+        ClusterAssignment sources(source_offsets[new_line_count]);
+        std::vector<std::size_t> fill(source_offsets.begin(), source_offsets.end() - 1);
+        for (ClusterId old_line = 0; old_line < old_count; ++old_line) {
+            if (old_to_new[old_line] != nullCluster) sources[fill[old_to_new[old_line]]++] = old_line;
+        }
+
+        // Sizes first; re-sorted lines are kept aside until the copy
+        std::vector<std::vector<std::pair<ClusterId, EdgeCount>>> resorted(new_line_count);
+        std::vector<char> copied(new_line_count, 0);
+        std::vector<std::size_t> new_offsets(new_line_count + 1, 0);
+
+        #pragma omp parallel for schedule(dynamic, OMP_CHUNK_SIZE)
+        for (std::size_t new_line = 0; new_line < new_line_count; ++new_line) {
+            std::size_t first_source = source_offsets[new_line];
+            std::size_t last_source = source_offsets[new_line + 1];
+
+            if (last_source - first_source == 1) {
+                ClusterId old_line = sources[first_source];
+                bool ascending = true;
+                for (std::size_t idx = begin(old_line) + 1; idx < end(old_line) && ascending; ++idx) {
+                    ascending = old_to_new[clusters[idx - 1]] < old_to_new[clusters[idx]];
+                }
+                if (ascending) {
+                    copied[new_line] = 1;
+                    new_offsets[new_line + 1] = end(old_line) - begin(old_line);
+                    continue;
+                }
+            }
+
+            auto& entries = resorted[new_line];
+            for (std::size_t source = first_source; source < last_source; ++source) {
+                for (std::size_t idx = begin(sources[source]); idx < end(sources[source]); ++idx) {
+                    entries.emplace_back(old_to_new[clusters[idx]], counts[idx]);
+                }
+            }
+            std::ranges::sort(entries);
+
+            std::size_t kept = 0;
+            for (const auto& entry : entries) {
+                if (kept > 0 && entries[kept - 1].first == entry.first) {
+                    entries[kept - 1].second += entry.second;
+                } else {
+                    entries[kept++] = entry;
+                }
+            }
+            entries.resize(kept);
+            new_offsets[new_line + 1] = kept;
+        }
+
+        for (std::size_t idx = 0; idx < new_line_count; ++idx) {
+            new_offsets[idx + 1] += new_offsets[idx];
+        }
+
+        std::vector<ClusterId> new_clusters(new_offsets[new_line_count]);
+        std::vector<EdgeCount> new_counts(new_offsets[new_line_count]);
+
+        #pragma omp parallel for schedule(dynamic, OMP_CHUNK_SIZE)
+        for (std::size_t new_line = 0; new_line < new_line_count; ++new_line) {
+            std::size_t position = new_offsets[new_line];
+            if (copied[new_line] != 0) {
+                ClusterId old_line = sources[source_offsets[new_line]];
+                for (std::size_t idx = begin(old_line); idx < end(old_line); ++idx, ++position) {
+                    new_clusters[position] = old_to_new[clusters[idx]];
+                    new_counts[position] = counts[idx];
+                }
+            } else {
+                for (const auto& [cluster, count] : resorted[new_line]) {
+                    new_clusters[position] = cluster;
+                    new_counts[position] = count;
+                    ++position;
+                }
+            }
+        }
+
+        offsets = std::move(new_offsets);
+        clusters = std::move(new_clusters);
+        counts = std::move(new_counts);
+    } // contract()
+};
+
+// Sparse snapshot of a block matrix for kernels that only need the non-zero
+// entries of a few rows and columns. Undirected matrices are symmetric, so
+// their columns are the rows and are not stored.
+struct SparseBlockRows {
+    bool directed{false};
+    SparseBlockLines rows;
+    SparseBlockLines columns;
+
+    void build(const BlockModel& block_model) {
+        directed = block_model.graph != nullptr && block_model.graph->directed;
+        fill_lines(block_model, rows, false);
+        if (directed) {
+            fill_lines(block_model, columns, true);
+        } else {
+            columns = SparseBlockLines{};
+        }
+    }
+
+    // Patches the snapshot after BlockModel::contract with the same table
+    void contract(const ClusterAssignment& old_to_new, ClusterCount new_cluster_count) {
+        rows.contract(old_to_new, new_cluster_count);
+        if (directed) columns.contract(old_to_new, new_cluster_count);
+    }
+
+private:
+    // Two passes over the matrix: count each line's non-zeros, then fill
+    // them in at the prefix-summed offsets
+    static void fill_lines(const BlockModel& block_model, SparseBlockLines& lines, bool by_column) {
+        auto cluster_count = static_cast<ClusterId>(block_model.cluster_count);
+        const auto& matrix = block_model.block_matrix;
+
+        auto entry = [&matrix, by_column](ClusterId line, ClusterId other) {
+            return by_column ? matrix[other][line] : matrix[line][other];
+        };
+
+        lines.offsets.assign(cluster_count + 1, 0);
+
+        #pragma omp parallel for schedule(dynamic, OMP_CHUNK_SIZE)
+        for (ClusterId line = 0; line < cluster_count; ++line) {
+            std::size_t non_zeros = 0;
+            for (ClusterId other = 0; other < cluster_count; ++other) {
+                if (entry(line, other) != 0) ++non_zeros;
+            }
+            lines.offsets[line + 1] = non_zeros;
+        }
+
+        for (ClusterId line = 0; line < cluster_count; ++line) {
+            lines.offsets[line + 1] += lines.offsets[line];
+        }
+
+        lines.clusters.resize(lines.offsets[cluster_count]);
+        lines.counts.resize(lines.offsets[cluster_count]);
+
+        #pragma omp parallel for schedule(dynamic, OMP_CHUNK_SIZE)
+        for (ClusterId line = 0; line < cluster_count; ++line) {
+            std::size_t position = lines.offsets[line];
+            for (ClusterId other = 0; other < cluster_count; ++other) {
+                if (entry(line, other) != 0) {
+                    lines.clusters[position] = other;
+                    lines.counts[position] = entry(line, other);
+                    ++position;
+                }
+            }
+        }
+    }
+
+}; // SparseBlockRows
+
 } // sbp::utils
 
 #endif // SBP_BLOCKMODEL_HPP
@@ -0,0 +1,178 @@
+#ifndef SBP_COMPRESSED_HPP
+#define SBP_COMPRESSED_HPP
+
+#include "sbp_consts.hpp"
+#include "sbp_aliases.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <algorithm>
+
+namespace sbp::utils {
+
+using ByteBuffer = std::vector<std::uint8_t>;
+using ByteOffsets = std::vector<MemorySize>;
+using RecordOffsets = std::vector<std::uint32_t>;
+
+// Byte-aligned LEB128 varint: 7 payload bits per byte, high bit = continue
+inline void varint_encode(ByteBuffer& bytes, std::uint32_t value) {
+    while (value >= 0x80U) { // NOLINT
+        bytes.push_back(static_cast<std::uint8_t>(value | 0x80U)); // NOLINT
+        value >>= 7U; // NOLINT
+    }
+    bytes.push_back(static_cast<std::uint8_t>(value));
+}
+
+inline std::uint32_t varint_decode(const std::uint8_t*& cursor) {
+    std::uint32_t value = 0;
+    std::uint32_t shift = 0;
+    while (true) {
+        std::uint8_t byte = *cursor++;
+        value |= static_cast<std::uint32_t>(byte & 0x7FU) << shift; // NOLINT
+        if ((byte & 0x80U) == 0) { // NOLINT
+            return value;
+        }
+        shift += 7U; // NOLINT
+    }
+}
+
+// Walks either a plain neighbour array or a gap-encoded varint stream.
+// Both modes share one iterator type so neighbour-walk call sites do not
+// care which representation the graph currently uses.
+class NeighborIterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = VertexId;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = const VertexId*;
+    using reference         = VertexId;
+
+    NeighborIterator() = default;
+
+    NeighborIterator(const VertexId* plain, VertexCount remaining)
+        : plain_(plain), remaining_(remaining) {
+        if (remaining_ > 0) { current_ = *plain_; }
+    }
+
+    NeighborIterator(const std::uint8_t* encoded, VertexCount remaining)
+        : encoded_(encoded), remaining_(remaining) {
+        if (remaining_ > 0) {
+            current_ = static_cast<VertexId>(varint_decode(encoded_));
+        }
+    }
+
+    VertexId operator*() const { return current_; }
+
+    NeighborIterator& operator++() {
+        if (--remaining_ == 0) { return *this; }
+
+        if (plain_ != nullptr) {
+            current_ = *(++plain_);
+        } else {
+            current_ += static_cast<VertexId>(varint_decode(encoded_));
+        }
+        return *this;
+    }
+
+    NeighborIterator operator++(int) {
+        NeighborIterator previous = *this;
+        ++(*this);
+        return previous;
+    }
+
+    // Iterators of one range differ only in how many neighbours remain
+    bool operator==(const NeighborIterator& other) const {
+        return remaining_ == other.remaining_;
+    }
+
+private:
+    const VertexId* plain_{nullptr};
+    const std::uint8_t* encoded_{nullptr};
+    VertexId current_{0};
+    VertexCount remaining_{0};
+
+}; // NeighborIterator
+
+struct NeighborRange {
+    NeighborIterator first;
+    VertexCount count{0};
+
+    [[nodiscard]] NeighborIterator begin() const { return first; }
+    [[nodiscard]] NeighborIterator end() const { return {}; }
+    [[nodiscard]] VertexCount size() const { return count; }
+    [[nodiscard]] bool empty() const { return count == 0; }
+
+}; // NeighborRange
+
+// Sorted neighbour lists, each stored as varint(degree), varint(first id)
+// and varint gaps to the previous id. Typical graphs shrink 2-4x against
+// 32-bit ids since most gaps inside a sorted list fit in one or two bytes.
+// A record is found from a 64-bit base per compressedOffsetBlock vertices
+// plus a 32-bit offset from that base per vertex, so the index costs about
+// four bytes per vertex instead of eight.
+struct CompressedAdjacency {
+    ByteOffsets block_offsets;  // Start of each block's first record
+    RecordOffsets offsets;      // offsets[v] = start of v's record within its block, size N
+    ByteBuffer bytes;
+
+    [[nodiscard]] VertexCount get_vertex_count() const {
+        return offsets.size();
+    }
+
+    [[nodiscard]] const std::uint8_t* record(VertexId vertex) const {
+        return bytes.data() + block_offsets[vertex / compressedOffsetBlock] + offsets[vertex];
+    }
+
+    [[nodiscard]] VertexCount degree(VertexId vertex) const {
+        const std::uint8_t* cursor = record(vertex);
+        return varint_decode(cursor);
+    }
+
+    [[nodiscard]] NeighborRange neighbors(VertexId vertex) const {
+        const std::uint8_t* cursor = record(vertex);
+        VertexCount count = varint_decode(cursor);
+        return {NeighborIterator(cursor, count), count};
+    }
+
+    // Allocated bytes, containers included, counted like
+    // Graph::adjacency_memory_bytes counts the plain lists
+    [[nodiscard]] MemorySize memory_bytes() const {
+        return sizeof(CompressedAdjacency) +
+               bytes.capacity() * sizeof(std::uint8_t) +
+               offsets.capacity() * sizeof(std::uint32_t) +
+               block_offsets.capacity() * sizeof(MemorySize);
+    }
+
+    // Sorts each list in place and appends its gap-encoded record
+    static CompressedAdjacency encode(AdjacencyList& adjacency) {
+        CompressedAdjacency compressed;
+        compressed.offsets.reserve(adjacency.size());
+        compressed.block_offsets.reserve((adjacency.size() + compressedOffsetBlock - 1) / compressedOffsetBlock);
+
+        for (auto& neighbors : adjacency) {
+            std::ranges::sort(neighbors);
+            if (compressed.offsets.size() % compressedOffsetBlock == 0) {
+                compressed.block_offsets.push_back(compressed.bytes.size());
+            }
+            compressed.offsets.push_back(
+                static_cast<std::uint32_t>(compressed.bytes.size() - compressed.block_offsets.back())
+            );
+            varint_encode(compressed.bytes, static_cast<std::uint32_t>(neighbors.size()));
+
+            VertexId previous = 0;
+            for (auto neighbor : neighbors) {
+                varint_encode(compressed.bytes, static_cast<std::uint32_t>(neighbor - previous));
+                previous = neighbor;
+            }
+        }
+
+        compressed.bytes.shrink_to_fit();
+        return compressed;
+    }
+
+}; // CompressedAdjacency
+
+} // sbp::utils
+
+#endif // SBP_COMPRESSED_HPP
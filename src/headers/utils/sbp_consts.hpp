@@ -11,6 +11,7 @@ constexpr IterationCount defaultCount = 100;
 
 constexpr MemorySize KiB = 1024;
 constexpr MemorySize MiB = KiB * KiB;
+constexpr VertexCount compressedOffsetBlock = 64;     // Vertices per 64-bit base of compressed record offsets
 
 // Cluster configuration
 constexpr ClusterCount minClusterCount = 1;
@@ -19,6 +20,37 @@ constexpr ClusterCount binarySplitCount = 2;
 // Algorithm tuning parameters
 constexpr ToleranceFactor splitToleranceFactor = 0.05;  // 5% tolerance for split acceptance
 constexpr IterationCount mcmcRefinementMultiplier = 10;  // 10*N iterations per split
+constexpr std::size_t lptSlicesPerThread = 4;            // LPT plan: no slice above total / (4 * threads)
+constexpr Probability defaultSplitBatchFraction = 0.5;   // Multi-split: split up to K/2 clusters per round
+
+// Split proposer parameters
+constexpr IterationCount spectralPowerIterations = 30;   // Power iterations per Fiedler estimate
+constexpr IterationCount labelPropagationSweeps = 5;     // Max sweeps of two-label propagation
+constexpr VertexCount mixedProposerMinVertices = 128;    // Mixed mode: snowball below this size
+constexpr ProposalCount mixedLargeClusterProposals = 5;  // Mixed mode: spectral + label propagation above it
+constexpr IterationCount fmMaxPasses = 4;                // FM passes over the best split
+
+// Dense (bit-matrix) snowball path
+constexpr VertexCount denseSnowballMinVertices = 64;     // Below one word per row lists are as cheap
+constexpr VertexCount denseSnowballMaxVertices = 8192;   // Bit matrix stays within 8 MiB
+constexpr VertexCount denseSnowballDensityDivisor = 32;  // Dense once arcs * 32 >= n^2
+
+// Sampled split search
+constexpr VertexCount sampledSplitMinVertices = 20000;   // Clusters this large are searched on a sample
+constexpr Probability sampledSplitFraction = 0.2;        // Share of the cluster's vertices sampled
+constexpr VertexCount sampledSplitMinSample = 4096;      // Smallest sample worth searching
+
+// Adaptive proposal counts
+constexpr ProposalCount adaptiveMinProposals = 4;         // Floor of the size-scaled budget
+constexpr ProposalCount adaptiveMaxProposalFactor = 2;    // Ceiling: twice the base count
+constexpr VertexCount adaptiveReferenceVertices = 1024;   // Cluster size that gets the base count
+constexpr ProposalCount proposalPatience = 10;            // Stop after this many without improvement
+constexpr ProposalCount proposalFoldInterval = proposalPatience / 2; // Proposals per statistics fold in a slice
+constexpr Probability proposalSpreadTolerance = 1e-4;     // Stop once std(H) / |mean H| is below this
+
+// Low-degree pruning parameters
+constexpr VertexCount defaultPeelDegree = 2;             // Peel isolated vertices and leaves
+constexpr IterationCount reattachMcmcMultiplier = 10;    // Iterations per reattached vertex
 
 // Bottom-up SBP parameters (tuned for accuracy over speed)
 constexpr IterationCount bottomUpMcmcMultiplier = 50;   // Iterations per cluster count (increased from 10)
@@ -27,6 +59,13 @@ constexpr Probability mergeBatchSizeFactor = 0.5;       // Merge up to 50% of cl
 constexpr VertexCount mcmcThresholdDivisor = 5;         // Start MCMC when clusters < N/5 (was N/10)
 constexpr ToleranceFactor mergeToleranceFactor = 0.01;  // 1% tolerance for merge acceptance
 constexpr IterationCount forcedMergeMcmcMultiplier = 100; // Extra MCMC after forced merges
+constexpr IterationCount mergeCandidateSamples = 10;    // Sampled partners per cluster (sampled merges)
+constexpr IterationCount mergeSelectionMaxRounds = 8;   // Parallel merge-selection rounds before the serial greedy
+
+// Automatic cluster-count selection
+constexpr Probability autoKGrowthFactor = 2.0;          // Top-down: K doubles per exploration step
+constexpr Probability autoKReductionFactor = 0.5;       // Bottom-up: K halves per exploration step
+constexpr Probability goldenSectionRatio = 0.381966;    // 2 - golden ratio
 
 }; // sbp::utils
 
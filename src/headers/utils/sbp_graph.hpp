@@ -2,15 +2,26 @@
 #define SBP_GRAPH_HPP
 
 #include "sbp_aliases.hpp"
+#include "sbp_compressed.hpp"
 
 namespace sbp::utils {
 
 struct Graph {
-    AdjacencyList adjacency_list;
+    AdjacencyList adjacency_list;     // Out-neighbours (all neighbours if undirected)
+    AdjacencyList in_adjacency_list;  // In-neighbours, only populated for directed graphs
+    bool directed{false};
+
+    // Optional varint encoding; once compress() ran the plain lists are empty
+    CompressedAdjacency compressed_adjacency;
+    CompressedAdjacency compressed_in_adjacency;
+    bool compressed{false};
 
     Graph() = default;
 
     [[nodiscard]] VertexCount get_vertex_count() const {
+        if (compressed) {
+            return compressed_adjacency.get_vertex_count();
+        }
         return static_cast <VertexCount> (
             adjacency_list.size()
         );
@@ -18,23 +29,138 @@ struct Graph {
 
     [[nodiscard]] EdgeCount get_edge_count() const {
         EdgeCount count = 0;
-        for (const auto& neighbors : adjacency_list) {
-            count += neighbors.size();
+        for (VertexId vertex = 0;
+             vertex < static_cast<VertexId>(get_vertex_count());
+             ++vertex) {
+            count += degree(vertex);
+        }
+
+        if (directed) {
+            return count;  // Each arc is stored once, in its tail's out-list
         }
         return count / 2;  // Each edge is counted twice in undirected graph
     }
 
-}; // Graph
+    [[nodiscard]] bool is_directed() const {
+        return directed;
+    }
 
-struct SubGraph {
+    // Out-neighbours (all neighbours if undirected), in either representation
+    [[nodiscard]] NeighborRange neighbors(VertexId vertex) const {
+        if (compressed) {
+            return compressed_adjacency.neighbors(vertex);
+        }
+        const auto& list = adjacency_list[vertex];
+        return {NeighborIterator(list.data(), list.size()), list.size()};
+    }
 
-    Graph graph;
-    VertexMapping subgraph_mapping;
+    [[nodiscard]] NeighborRange in_neighbors(VertexId vertex) const {
+        if (!directed) {
+            return {};
+        }
+        if (compressed) {
+            return compressed_in_adjacency.neighbors(vertex);
+        }
+        const auto& list = in_adjacency_list[vertex];
+        return {NeighborIterator(list.data(), list.size()), list.size()};
+    }
 
-}; // SubGraph
+    [[nodiscard]] VertexCount degree(VertexId vertex) const {
+        return compressed 
+            ? compressed_adjacency.degree(vertex) 
+            : adjacency_list[vertex].size();
+    }
 
-} // sbp::utils
+    [[nodiscard]] VertexCount in_degree(VertexId vertex) const {
+        if (!directed) {
+            return 0;
+        }
+        return compressed 
+            ? compressed_in_adjacency.degree(vertex) 
+            : in_adjacency_list[vertex].size();
+    }
 
-#endif // SBP_GRAPH_HPP
+    // Index into the out-list; O(index) decode when compressed
+    [[nodiscard]] VertexId neighbor_at(VertexId vertex, VertexCount index) const {
+        if (!compressed) {
+            return adjacency_list[vertex][index];
+        }
+        auto neighbor = compressed_adjacency.neighbors(vertex).begin();
+        std::advance(neighbor, index);
+        return *neighbor;
+    }
+
+    [[nodiscard]] VertexId in_neighbor_at(VertexId vertex, VertexCount index) const {
+        if (!compressed) {
+            return in_adjacency_list[vertex][index];
+        }
+        auto neighbor = compressed_in_adjacency.neighbors(vertex).begin();
+        std::advance(neighbor, index);
+        return *neighbor;
+    }
 
+    // Replaces the plain lists with their sorted varint encoding.
+    // Call after the graph (and build_in_adjacency) is complete.
+    void compress() {
+        if (compressed) { return; }
 
+        compressed_adjacency = CompressedAdjacency::encode(adjacency_list);
+        if (directed) {
+            compressed_in_adjacency = CompressedAdjacency::encode(in_adjacency_list);
+        }
+
+        AdjacencyList().swap(adjacency_list);
+        AdjacencyList().swap(in_adjacency_list);
+        compressed = true;
+    }
+
+    // Allocated bytes of neighbour storage, counted alike for both forms:
+    // the containers themselves plus their capacity (per-list vectors and
+    // their payloads, or the varint records and their offsets)
+    [[nodiscard]] MemorySize adjacency_memory_bytes() const {
+        if (compressed) {
+            return compressed_adjacency.memory_bytes() + compressed_in_adjacency.memory_bytes();
+        }
+
+        auto list_bytes = [](const AdjacencyList& lists) {
+            MemorySize total = sizeof(AdjacencyList) + lists.capacity() * sizeof(VertexList);
+            for (const auto& neighbors : lists) total += neighbors.capacity() * sizeof(VertexId);
+            return total;
+        };
+        return list_bytes(adjacency_list) + list_bytes(in_adjacency_list);
+    }
+
+    // Rebuilds in_adjacency_list as the transpose of adjacency_list.
+    // Generators fill the out-lists only and call this once at the end.
+    void build_in_adjacency() {
+        in_adjacency_list.clear();
+        if (!directed) { return; }
+
+        std::vector<VertexCount> in_degrees(adjacency_list.size(), 0);
+        for (const auto& out_list : adjacency_list) {
+            for (auto vertex_v : out_list) {
+                ++in_degrees[vertex_v];
+            }
+        }
+
+        in_adjacency_list.resize(adjacency_list.size());
+        for (VertexId vertex = 0;
+             vertex < static_cast<VertexId>(adjacency_list.size());
+             ++vertex) {
+            in_adjacency_list[vertex].reserve(in_degrees[vertex]);
+        }
+
+        for (VertexId vertex_u = 0;
+             vertex_u < static_cast<VertexId>(adjacency_list.size());
+             ++vertex_u) {
+            for (auto vertex_v : adjacency_list[vertex_u]) {
+                in_adjacency_list[vertex_v].push_back(vertex_u);
+            }
+        }
+    }
+
+}; // Graph
+
+} // sbp::utils
+
+#endif // SBP_GRAPH_HPP
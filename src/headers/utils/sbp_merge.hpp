@@ -0,0 +1,287 @@
+#ifndef SBP_MERGE_HPP
+#define SBP_MERGE_HPP
+
+#include "sbp_consts.hpp"
+#include "sbp_aliases.hpp"
+
+#include <tuple>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <numeric>
+#include <algorithm>
+
+namespace sbp::utils {
+
+// A candidate merge of two clusters. The key is the entropy part of its ΔH
+// (ΔH + K log N): it does not depend on K, so it stays exact as long as
+// neither cluster's block-matrix lines nor their neighbours' sizes change.
+struct MergeCandidate {
+    DescriptionLength key{inf};
+    ClusterId c1{nullCluster};
+    ClusterId c2{nullCluster};
+    std::uint64_t stamp1{0};
+    std::uint64_t stamp2{0};
+};
+
+// Bottom-up agglomeration queue with lazy invalidation. Every cluster holds
+// a version stamp and a heap of the candidate merges it takes part in, and
+// the front of each heap is kept live: it is the cluster's best merge.
+// Invalidating a cluster moves its stamp to a fresh epoch, which kills all
+// of its entries at once; only the partners whose front died re-read their
+// heaps, discarding dead entries on the way. Pushes and invalidations thus
+// cost the entries they touch times log of a heap, never a pass over all
+// pairs. Ties on the key go to the lower (c1, c2), so the order is
+// deterministic.
+struct MergeQueue {
+    std::vector<std::vector<MergeCandidate>> heaps;
+    std::vector<std::uint64_t> versions;
+    std::uint64_t epoch{0};
+
+    [[nodiscard]] static bool worse(const MergeCandidate& a, const MergeCandidate& b) {
+        return std::tie(a.key, a.c1, a.c2) > std::tie(b.key, b.c1, b.c2);
+    }
+
+    [[nodiscard]] bool live(const MergeCandidate& candidate) const {
+        return versions[candidate.c1] == candidate.stamp1 && versions[candidate.c2] == candidate.stamp2;
+    }
+
+    // Starts over with no entries and every cluster at a fresh version
+    void invalidate_all(ClusterCount cluster_count) {
+        ++epoch;
+        versions.assign(cluster_count, epoch);
+        heaps.assign(cluster_count, {});
+    }
+
+    // Kills every entry of `clusters`. Returns the killed pairs as
+    // (partner, cluster) for the partners outside `clusters`, whose side
+    // of the pair is gone too.
+    std::vector<std::pair<ClusterId, ClusterId>> invalidate(const ClusterAssignment& clusters) {
+        std::vector<std::pair<ClusterId, ClusterId>> killed;
+        for (auto cluster : clusters) {
+            for (const auto& candidate : heaps[cluster]) {
+                if (live(candidate)) {
+                    killed.emplace_back(candidate.c1 == cluster ? candidate.c2 : candidate.c1, cluster);
+                }
+            }
+        }
+
+        ++epoch;
+        for (auto cluster : clusters) {
+            versions[cluster] = epoch;
+            heaps[cluster].clear();
+        }
+
+        std::erase_if(killed, [this](const auto& pair) { return versions[pair.first] == epoch; });
+        for (const auto& [partner, cluster] : killed) {
+            discard_dead_front(partner);
+        }
+        return killed;
+    }
+
+    void push(DescriptionLength key, ClusterId c1, ClusterId c2) {
+        if (c2 < c1) std::swap(c1, c2);
+        MergeCandidate candidate{key, c1, c2, versions[c1], versions[c2]};
+        for (ClusterId cluster : {c1, c2}) {
+            heaps[cluster].push_back(candidate);
+            std::ranges::push_heap(heaps[cluster], worse);
+        }
+    }
+
+    // Each cluster's best entry with a key below `limit`, one copy per pair,
+    // best first: the "best partner of either cluster" proposals of a merge
+    // round, read from the heap fronts in O(K)
+    [[nodiscard]] std::vector<MergeCandidate> best_per_cluster(
+        ClusterCount cluster_count,
+        DescriptionLength limit) const {
+
+        auto front = [this](ClusterId cluster) -> const MergeCandidate* {
+            return heaps[cluster].empty() ? nullptr : &heaps[cluster].front();
+        };
+
+        std::vector<MergeCandidate> proposals;
+        for (ClusterId cluster = 0; cluster < static_cast<ClusterId>(cluster_count); ++cluster) {
+            const auto* candidate = front(cluster);
+            if (candidate == nullptr || candidate->key >= limit) continue;
+            // A pair that is best for both of its clusters is listed once
+            const auto* other = front(candidate->c1 == cluster ? candidate->c2 : candidate->c1);
+            bool shared = other != nullptr && other->c1 == candidate->c1 && other->c2 == candidate->c2;
+            if (!shared || candidate->c1 == cluster) proposals.push_back(*candidate);
+        }
+
+        std::ranges::sort(proposals, [](const MergeCandidate& a, const MergeCandidate& b) { return worse(b, a); });
+        return proposals;
+    }
+
+    // Carries the queue through a cluster renumbering (old id -> new id,
+    // nullCluster for removed clusters) in one pass over the entries: dead
+    // ones are dropped, live ones renumbered and stamped with a fresh
+    // epoch. Merged clusters share a new id and heap, and must be
+    // invalidated by the caller right after.
+    void relabel(const ClusterAssignment& old_to_new, ClusterCount new_cluster_count) {
+        ++epoch;
+        std::vector<std::vector<MergeCandidate>> new_heaps(new_cluster_count);
+        for (ClusterId old_cluster = 0; old_cluster < static_cast<ClusterId>(old_to_new.size()); ++old_cluster) {
+            ClusterId new_cluster = old_to_new[old_cluster];
+            if (new_cluster == nullCluster) continue;
+
+            auto& heap = new_heaps[new_cluster];
+            for (const auto& candidate : heaps[old_cluster]) {
+                ClusterId c1 = old_to_new[candidate.c1];
+                ClusterId c2 = old_to_new[candidate.c2];
+                if (!live(candidate) || c1 == nullCluster || c2 == nullCluster || c1 == c2) continue;
+                heap.push_back({candidate.key, std::min(c1, c2), std::max(c1, c2), epoch, epoch});
+            }
+        }
+
+        for (auto& heap : new_heaps) {
+            std::ranges::make_heap(heap, worse);
+        }
+        heaps = std::move(new_heaps);
+        versions.assign(new_cluster_count, epoch);
+    }
+
+private:
+    void discard_dead_front(ClusterId cluster) {
+        auto& heap = heaps[cluster];
+        while (!heap.empty() && !live(heap.front())) {
+            std::ranges::pop_heap(heap, worse);
+            heap.pop_back();
+        }
+    }
+
+}; // MergeQueue
+
+// Greedy independent merge selection, in parallel. Proposals are ranked by
+// position; the serial greedy pass keeps proposal i iff no better-ranked
+// kept proposal shares a cluster with it. Each round here keeps every
+// undecided proposal that is the best undecided one at both of its
+// clusters (all better neighbours are then decided and dropped), marks its
+// clusters in a bitmap and drops the undecided proposals touching a marked
+// cluster, so the kept set is exactly the greedy one. A round only sweeps
+// the clusters of undecided proposals, and rounds stop once the decided
+// prefix already holds max_merges kept proposals. A chain of proposals
+// that each wait on the previous one decides only a few per round, so
+// after mergeSelectionMaxRounds the serial greedy decides the rest in rank
+// order. Returns the kept indices in rank order, at most max_merges of them.
+inline std::vector<std::size_t> select_independent_merges(
+    const std::vector<MergeCandidate>& ranked,
+    ClusterCount cluster_count,
+    std::size_t max_merges) {
+
+    enum : char { Undecided, Kept, Dropped };
+
+    std::size_t proposal_count = ranked.size();
+    auto clusters = static_cast<ClusterId>(cluster_count);
+
+    // Proposals incident to each cluster, in rank order (counting sort)
+    std::vector<std::size_t> offsets(cluster_count + 1, 0);
+    for (const auto& proposal : ranked) {
+        ++offsets[proposal.c1 + 1];
+        ++offsets[proposal.c2 + 1];
+    }
+    for (ClusterId cluster = 0; cluster < clusters; ++cluster) {
+        offsets[cluster + 1] += offsets[cluster];
+    }
+    std::vector<std::size_t> incident(offsets[cluster_count]);
+    std::vector<std::size_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (std::size_t idx = 0; idx < proposal_count; ++idx) {
+        incident[cursor[ranked[idx].c1]++] = idx;
+        incident[cursor[ranked[idx].c2]++] = idx;
+    }
+    std::copy(offsets.begin(), offsets.end() - 1, cursor.begin());
+
+    std::vector<char> state(proposal_count, Undecided);
+    std::vector<std::uint64_t> marked((cluster_count + 63) / 64, 0); // NOLINT
+    auto is_marked = [&marked](ClusterId cluster) {
+        return ((marked[cluster / 64] >> (cluster % 64)) & 1U) != 0; // NOLINT
+    };
+
+    std::vector<std::size_t> undecided(proposal_count);
+    std::iota(undecided.begin(), undecided.end(), 0);
+    std::size_t decided_prefix = 0;
+    std::size_t kept_in_prefix = 0;
+
+    std::vector<ClusterId> active;
+    std::vector<IterationCount> active_round(cluster_count, 0);
+
+    for (IterationCount round = 1; !undecided.empty(); ++round) {
+        if (round > mergeSelectionMaxRounds) {
+            for (auto idx : undecided) {
+                const auto& proposal = ranked[idx];
+                if (is_marked(proposal.c1) || is_marked(proposal.c2)) {
+                    state[idx] = Dropped;
+                    continue;
+                }
+                state[idx] = Kept;
+                marked[proposal.c1 / 64] |= std::uint64_t{1} << (proposal.c1 % 64); // NOLINT
+                marked[proposal.c2 / 64] |= std::uint64_t{1} << (proposal.c2 % 64); // NOLINT
+            }
+            undecided.clear();
+        } else {
+            // Clusters of the undecided proposals; no other cursor can move
+            active.clear();
+            for (auto idx : undecided) {
+                for (ClusterId cluster : {ranked[idx].c1, ranked[idx].c2}) {
+                    if (active_round[cluster] != round) {
+                        active_round[cluster] = round;
+                        active.push_back(cluster);
+                    }
+                }
+            }
+
+            // Each active cluster's best undecided proposal; cursors only move forward
+            #pragma omp parallel for schedule(static)
+            for (std::size_t pos = 0; pos < active.size(); ++pos) {
+                ClusterId cluster = active[pos];
+                while (cursor[cluster] < offsets[cluster + 1] && state[incident[cursor[cluster]]] != Undecided) {
+                    ++cursor[cluster];
+                }
+            }
+
+            auto owns = [&](ClusterId cluster, std::size_t idx) {
+                return cursor[cluster] < offsets[cluster + 1] && incident[cursor[cluster]] == idx;
+            };
+
+            #pragma omp parallel for schedule(static)
+            for (std::size_t pos = 0; pos < undecided.size(); ++pos) {
+                std::size_t idx = undecided[pos];
+                const auto& proposal = ranked[idx];
+                if (owns(proposal.c1, idx) && owns(proposal.c2, idx)) {
+                    state[idx] = Kept;
+                    #pragma omp atomic
+                    marked[proposal.c1 / 64] |= std::uint64_t{1} << (proposal.c1 % 64); // NOLINT
+                    #pragma omp atomic
+                    marked[proposal.c2 / 64] |= std::uint64_t{1} << (proposal.c2 % 64); // NOLINT
+                }
+            }
+
+            #pragma omp parallel for schedule(static)
+            for (std::size_t pos = 0; pos < undecided.size(); ++pos) {
+                std::size_t idx = undecided[pos];
+                if (state[idx] == Undecided && (is_marked(ranked[idx].c1) || is_marked(ranked[idx].c2))) {
+                    state[idx] = Dropped;
+                }
+            }
+
+            std::erase_if(undecided, [&state](std::size_t idx) { return state[idx] != Undecided; });
+        }
+
+        // Everything ranked above the best undecided proposal is final
+        std::size_t prefix_end = undecided.empty() ? proposal_count : undecided.front();
+        for (; decided_prefix < prefix_end; ++decided_prefix) {
+            if (state[decided_prefix] == Kept) ++kept_in_prefix;
+        }
+        if (kept_in_prefix >= max_merges) break;
+    }
+
+    std::vector<std::size_t> selected;
+    for (std::size_t idx = 0; idx < decided_prefix && selected.size() < max_merges; ++idx) {
+        if (state[idx] == Kept) selected.push_back(idx);
+    }
+    return selected;
+}
+
+} // sbp::utils
+
+#endif // SBP_MERGE_HPP
@@ -0,0 +1,62 @@
+#ifndef SBP_SCHEDULE_HPP
+#define SBP_SCHEDULE_HPP
+
+#include "sbp_consts.hpp"
+#include "sbp_aliases.hpp"
+
+#include <vector>
+#include <numeric>
+#include <algorithm>
+
+namespace sbp::utils {
+
+// A share of one cluster's work: the sub-range [first, last) of its extent
+// (partner clusters, proposals, ...) with its estimated cost
+struct WorkSlice {
+    ClusterId cluster{nullCluster};
+    std::size_t first{0};
+    std::size_t last{0};
+    std::size_t cost{0};
+};
+
+// Longest-processing-time plan for per-cluster work. A cluster whose cost
+// exceeds total / (threads * lptSlicesPerThread) is cut into equal slices of
+// its extent (extent 1 means indivisible), and slices are ordered
+// largest-first, so a dynamic schedule of size 1 over the plan is greedy LPT
+// list scheduling. Zero-cost clusters are left out; ties keep cluster order.
+inline std::vector<WorkSlice> plan_cluster_work(
+    const std::vector<std::size_t>& costs,
+    const std::vector<std::size_t>& extents,
+    int thread_count) {
+
+    std::size_t total_cost = std::accumulate(costs.begin(), costs.end(), std::size_t{0});
+    std::size_t slice_budget = std::max<std::size_t>(
+        1, total_cost / (static_cast<std::size_t>(std::max(thread_count, 1)) * lptSlicesPerThread)
+    );
+
+    std::vector<WorkSlice> plan;
+    plan.reserve(costs.size());
+
+    for (ClusterId cluster = 0; cluster < static_cast<ClusterId>(costs.size()); ++cluster) {
+        std::size_t cost = costs[cluster];
+        std::size_t extent = extents[cluster];
+        if (cost == 0 || extent == 0) continue;
+
+        std::size_t slices = std::min(extent, (cost + slice_budget - 1) / slice_budget);
+        for (std::size_t slice = 0; slice < slices; ++slice) {
+            std::size_t first = extent * slice / slices;
+            std::size_t last = extent * (slice + 1) / slices;
+            plan.push_back({cluster, first, last, cost * (last - first) / extent});
+        }
+    }
+
+    std::ranges::stable_sort(plan, [](const WorkSlice& a, const WorkSlice& b) {
+        return a.cost > b.cost;
+    });
+
+    return plan;
+}
+
+} // sbp::utils
+
+#endif // SBP_SCHEDULE_HPP
@@ -0,0 +1,879 @@
+#ifndef SBP_SPLIT_HPP
+#define SBP_SPLIT_HPP
+
+#include "sbp_rng.hpp"
+#include "sbp_consts.hpp"
+#include "sbp_aliases.hpp"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cmath>
+#include <tuple>
+#include <vector>
+#include <random>
+#include <numeric>
+#include <algorithm>
+
+namespace sbp::utils {
+
+// Split routines are templates over the graph type: anything exposing
+// get_vertex_count(), neighbors(), in_neighbors() and is_directed() works
+// (Graph, SubGraph).
+
+// Block model of a binary split, sized at compile time
+struct SplitBlockModel {
+    std::array<std::array<EdgeCount, binarySplitCount>, binarySplitCount> block_matrix{};
+    std::array<VertexCount, binarySplitCount> clusters_sizes{};
+    VertexCount vertex_count{0};
+
+    [[nodiscard]] DescriptionLength compute_H() const {
+        // Same formula as compute_H_from_counts, unrolled for two blocks
+        Entropy entropy = 0.0;
+        for (std::size_t i = 0; i < binarySplitCount; ++i) {
+            if (clusters_sizes[i] == 0) continue;
+            for (std::size_t j = 0; j < binarySplitCount; ++j) {
+                if (clusters_sizes[j] == 0 || block_matrix[i][j] == 0) continue;
+
+                Probability p_ij = (
+                    static_cast<Probability>(block_matrix[i][j]) /
+                    static_cast<Probability>(clusters_sizes[i] * clusters_sizes[j])
+                );
+                entropy += static_cast<Entropy>(block_matrix[i][j] * std::log(p_ij));
+            }
+        }
+
+        Probability model_complexity = (
+            0.5 * binarySplitCount * (binarySplitCount + 1) * // NOLINT
+            std::log(vertex_count)
+        );
+        return static_cast<DescriptionLength>(-entropy + model_complexity);
+    }
+
+}; // SplitBlockModel
+
+// H of a cluster kept whole, from its internal arc count and size alone
+inline DescriptionLength compute_single_block_H(
+    EdgeCount internal_edges,
+    VertexCount vertex_count) {
+
+    if (vertex_count == 0) {
+        return inf;
+    }
+
+    Entropy entropy = 0.0;
+    if (internal_edges > 0) {
+        Probability p_self = (
+            static_cast<Probability>(internal_edges) /
+            static_cast<Probability>(vertex_count * vertex_count)
+        );
+        entropy = static_cast<Entropy>(internal_edges * std::log(p_self));
+    }
+
+    // 0.5 * K * (K + 1) * log(N) with K = 1
+    return -entropy + std::log(vertex_count);
+}
+
+// How a cluster's binary split proposals are generated
+enum class SplitProposer {
+    Snowball,          // Random seeds, greedy connectivity growth
+    Spectral,          // Sign of the Fiedler vector (power iteration)
+    LabelPropagation,  // Snowball start, then two-label majority sweeps
+    Mixed              // Snowball for small clusters; spectral first, then
+                       // label propagation for large ones
+};
+
+// Proposal budget scaled by cluster size: the base count at
+// adaptiveReferenceVertices, growing with log2 of the size, clamped to
+// [adaptiveMinProposals, adaptiveMaxProposalFactor * base]
+inline ProposalCount adaptive_proposal_budget(
+    VertexCount vertex_count,
+    ProposalCount base_proposals) {
+
+    Probability scale = std::log2(static_cast<Probability>(std::max<VertexCount>(vertex_count, binarySplitCount))) /
+                        std::log2(static_cast<Probability>(adaptiveReferenceVertices));
+    auto budget = static_cast<ProposalCount>(std::ceil(scale * static_cast<Probability>(base_proposals)));
+    return std::clamp(budget, adaptiveMinProposals, std::max(adaptiveMinProposals, adaptiveMaxProposalFactor * base_proposals));
+}
+
+// Running statistics of one cluster's proposals for early stopping. Batches
+// are merged with Chan's parallel variance update, so tasks can report a
+// whole chunk at once.
+struct ProposalStopping {
+    ProposalCount evaluated{0};
+    ProposalCount since_improvement{0};
+    DescriptionLength best_h{inf};
+    Probability mean_h{0.0};
+    Probability m2_h{0.0};  // Sum of squared deviations from mean_h
+
+    // Folds in a batch; returns whether the search should stop
+    bool record(
+        ProposalCount count,
+        DescriptionLength batch_best,
+        Probability batch_mean,
+        Probability batch_m2) {
+
+        if (count == 0) return false;
+
+        Probability delta = batch_mean - mean_h;
+        auto total = static_cast<Probability>(evaluated + count);
+        mean_h += delta * static_cast<Probability>(count) / total;
+        m2_h += batch_m2 + delta * delta *
+                static_cast<Probability>(evaluated) * static_cast<Probability>(count) / total;
+        evaluated += count;
+
+        if (batch_best < best_h) {
+            best_h = batch_best;
+            since_improvement = 0;
+        } else {
+            since_improvement += count;
+        }
+
+        if (since_improvement >= proposalPatience) return true;
+
+        Probability spread = std::sqrt(m2_h / static_cast<Probability>(evaluated));
+        return evaluated >= adaptiveMinProposals && spread <= proposalSpreadTolerance * std::abs(mean_h);
+    }
+
+}; // ProposalStopping
+
+// Bit-matrix form of a small dense graph for snowball scoring: a vertex's
+// arcs into each side are one AND + popcount per word instead of a walk over
+// its adjacency list. Parallel arcs cannot be represented, so build() refuses
+// graphs that have them.
+struct DenseSplitGraph {
+    VertexCount vertex_count{0};
+    std::size_t words{0};
+    bool directed{false};
+    std::vector<std::uint64_t> out_rows;  // Row v: bit u set for arc v -> u
+    std::vector<std::uint64_t> in_rows;   // Directed only: bit u set for arc u -> v
+    std::vector<EdgeScore> self_loops;
+
+    [[nodiscard]] bool empty() const { return words == 0; }
+
+    [[nodiscard]] const std::uint64_t* out_row(VertexId vertex) const {
+        return out_rows.data() + static_cast<std::size_t>(vertex) * words;
+    }
+
+    [[nodiscard]] const std::uint64_t* in_row(VertexId vertex) const {
+        return (directed ? in_rows.data() : out_rows.data()) + static_cast<std::size_t>(vertex) * words;
+    }
+
+    // Builds the matrix when the graph is small and dense enough for the
+    // bit path to win; otherwise (or with parallel arcs) leaves it empty
+    template <typename GraphView>
+    bool build(const GraphView& graph) {
+        words = 0;
+        vertex_count = graph.get_vertex_count();
+        if (vertex_count < denseSnowballMinVertices || vertex_count > denseSnowballMaxVertices) {
+            return false;
+        }
+
+        EdgeCount arcs = 0;
+        for (VertexId vertex = 0; vertex < static_cast<VertexId>(vertex_count); ++vertex) {
+            for ([[maybe_unused]] VertexId neighbor : graph.neighbors(vertex)) ++arcs;
+        }
+        if (arcs * denseSnowballDensityDivisor < vertex_count * vertex_count) {
+            return false;
+        }
+
+        std::size_t row_words = (vertex_count + 63) / 64; // NOLINT
+        directed = graph.is_directed();
+        out_rows.assign(vertex_count * row_words, 0);
+        in_rows.assign(directed ? vertex_count * row_words : 0, 0);
+        self_loops.assign(vertex_count, 0);
+
+        for (VertexId vertex = 0; vertex < static_cast<VertexId>(vertex_count); ++vertex) {
+            for (VertexId neighbor : graph.neighbors(vertex)) {
+                if (neighbor == vertex) {
+                    ++self_loops[vertex];
+                    continue;
+                }
+
+                auto& word = out_rows[vertex * row_words + neighbor / 64]; // NOLINT
+                std::uint64_t bit = std::uint64_t{1} << (neighbor % 64); // NOLINT
+                if ((word & bit) != 0) {
+                    return false;  // Parallel arc
+                }
+                word |= bit;
+
+                if (directed) {
+                    in_rows[neighbor * row_words + vertex / 64] |= std::uint64_t{1} << (vertex % 64); // NOLINT
+                }
+            }
+        }
+
+        words = row_words;
+        return true;
+    }
+
+}; // DenseSplitGraph
+
+// Buffers of the FM refinement: per-vertex arc counts towards each side,
+// cut gains and the gain buckets (doubly linked lists threaded through
+// bucket_next / bucket_prev, one head per gain value)
+struct FmScratch {
+    std::vector<std::array<EdgeScore, binarySplitCount>> out_counts;
+    std::vector<std::array<EdgeScore, binarySplitCount>> in_counts;
+    std::vector<EdgeScore> self_loops;
+    std::vector<EdgeScore> gain;
+    std::vector<VertexId> bucket_head;
+    std::vector<VertexId> bucket_next;
+    std::vector<VertexId> bucket_prev;
+    std::vector<bool> locked;
+    VertexList moves;
+};
+
+// Reusable per-thread buffers, so proposals allocate nothing once warm
+struct SplitScratch {
+    ClusterAssignment assignment;
+    ClusterAssignment best_assignment;
+    VertexList order;
+    std::vector<Probability> vector;
+    std::vector<Probability> product;
+    std::vector<Probability> scale;
+    std::vector<std::uint64_t> side_bits;
+    FmScratch fm;
+
+    static SplitScratch& local() {
+        static thread_local SplitScratch scratch;
+        return scratch;
+    }
+
+}; // SplitScratch
+
+// Counts the 2x2 block matrix of an assignment in one pass
+template <typename GraphView>
+SplitBlockModel count_split_blocks(
+    const GraphView& graph,
+    const ClusterAssignment& assignment) {
+
+    SplitBlockModel model;
+    model.vertex_count = graph.get_vertex_count();
+
+    for (VertexId vertex = 0;
+         vertex < static_cast<VertexId>(graph.get_vertex_count());
+         ++vertex) {
+        auto cluster_u = assignment[vertex];
+        ++model.clusters_sizes[cluster_u];
+
+        for (VertexId neighbor : graph.neighbors(vertex)) {
+            ++model.block_matrix[cluster_u][assignment[neighbor]];
+        }
+    }
+
+    return model;
+}
+
+// Assigns every vertex listed in order (all unassigned, visited in random
+// order) to the side it has more arcs to among already-assigned vertices.
+// The model must already hold the sizes and arcs of the assigned vertices;
+// each new arc is counted when the later of its two endpoints gets assigned,
+// so no second pass over the edges is needed.
+template <typename GraphView>
+void snowball_grow(
+    const GraphView& graph,
+    ClusterAssignment& assignment,
+    VertexList& order,
+    SplitBlockModel& model) {
+
+    bool directed = graph.is_directed();
+
+    std::shuffle(
+        order.begin(),
+        order.end(),
+        RandomNumerGenerator::get_generator()
+    );
+
+    for (VertexId vertex : order) {
+        std::array<EdgeScore, binarySplitCount> out_score{};
+        std::array<EdgeScore, binarySplitCount> in_score{};
+        EdgeScore self_loops = 0;
+
+        for (VertexId neighbor : graph.neighbors(vertex)) {
+            if (neighbor == vertex) {
+                ++self_loops;
+            } else if (assignment[neighbor] != nullCluster) {
+                ++out_score[assignment[neighbor]];
+            }
+        }
+
+        // Directed graphs: in-neighbours count towards connectivity too
+        if (directed) {
+            for (VertexId neighbor : graph.in_neighbors(vertex)) {
+                if (neighbor != vertex && assignment[neighbor] != nullCluster) {
+                    ++in_score[assignment[neighbor]];
+                }
+            }
+        }
+
+        EdgeScore score0 = out_score[0] + in_score[0];
+        EdgeScore score1 = out_score[1] + in_score[1];
+
+        ClusterId cluster = 0;
+        if (score1 > score0) {
+            cluster = 1;
+        } else if (score0 == score1) {
+            cluster = RandomNumerGenerator::random_int(0, 1);
+        }
+
+        assignment[vertex] = cluster;
+        ++model.clusters_sizes[cluster];
+        model.block_matrix[cluster][cluster] += self_loops;
+
+        for (std::size_t side = 0; side < binarySplitCount; ++side) {
+            model.block_matrix[cluster][side] += out_score[side];
+            // Undirected: mirror entry; directed: arcs arriving from the side
+            model.block_matrix[side][cluster] += directed ? in_score[side] : out_score[side];
+        }
+    }
+}
+
+// One snowball proposal: two random seeds, then every other vertex (in
+// random order) joins the side it has more edges to.
+template <typename GraphView>
+SplitBlockModel snowball_split_proposal(
+    const GraphView& graph,
+    ClusterAssignment& assignment,
+    VertexList& order) {
+
+    VertexCount vertex_count = graph.get_vertex_count();
+
+    SplitBlockModel model;
+    model.vertex_count = vertex_count;
+
+    // Select two random seed vertices for binary split
+    VertexId seed1 = RandomNumerGenerator::random_int(
+        0, static_cast<int>(vertex_count) - 1
+    );
+
+    VertexId seed2 = RandomNumerGenerator::random_int(
+        0, static_cast<int>(vertex_count) - 1
+    );
+
+    while (seed2 == seed1) {
+        seed2 = RandomNumerGenerator::random_int(
+            0, static_cast<int>(vertex_count) - 1
+        );
+    }
+
+    assignment.assign(vertex_count, nullCluster);
+
+    assignment[seed1] = 0;
+    assignment[seed2] = 1;
+    model.clusters_sizes = {1, 1};
+
+    // Arcs among the seeds (both stored directions for undirected graphs)
+    for (VertexId seed : {seed1, seed2}) {
+        for (VertexId neighbor : graph.neighbors(seed)) {
+            if (neighbor == seed1 || neighbor == seed2) {
+                ++model.block_matrix[assignment[seed]][assignment[neighbor]];
+            }
+        }
+    }
+
+    // Collect unassigned vertices
+    order.clear();
+    for (VertexId i = 0; i < static_cast<VertexId>(vertex_count); ++i) {
+        if (i != seed1 && i != seed2) {
+            order.push_back(i);
+        }
+    }
+
+    snowball_grow(graph, assignment, order, model);
+    return model;
+}
+
+// Snowball proposal on the bit-matrix form; same seeds, visiting order and
+// side choice as snowball_split_proposal, with each vertex scored by
+// popcounts against the two side bitsets
+inline SplitBlockModel dense_snowball_split_proposal(
+    const DenseSplitGraph& dense,
+    ClusterAssignment& assignment,
+    VertexList& order,
+    std::vector<std::uint64_t>& side_bits) {
+
+    VertexCount vertex_count = dense.vertex_count;
+    std::size_t words = dense.words;
+
+    SplitBlockModel model;
+    model.vertex_count = vertex_count;
+
+    VertexId seed1 = RandomNumerGenerator::random_int(
+        0, static_cast<int>(vertex_count) - 1
+    );
+
+    VertexId seed2 = RandomNumerGenerator::random_int(
+        0, static_cast<int>(vertex_count) - 1
+    );
+
+    while (seed2 == seed1) {
+        seed2 = RandomNumerGenerator::random_int(
+            0, static_cast<int>(vertex_count) - 1
+        );
+    }
+
+    assignment.assign(vertex_count, nullCluster);
+    side_bits.assign(binarySplitCount * words, 0);
+
+    auto place = [&](VertexId vertex, ClusterId side) {
+        assignment[vertex] = side;
+        side_bits[side * words + vertex / 64] |= std::uint64_t{1} << (vertex % 64); // NOLINT
+        ++model.clusters_sizes[side];
+    };
+
+    auto has_arc = [&](VertexId from, VertexId to) {
+        return (dense.out_row(from)[to / 64] >> (to % 64)) & 1U; // NOLINT
+    };
+
+    place(seed1, 0);
+    place(seed2, 1);
+    model.block_matrix[0][0] += dense.self_loops[seed1];
+    model.block_matrix[1][1] += dense.self_loops[seed2];
+    model.block_matrix[0][1] += has_arc(seed1, seed2);
+    model.block_matrix[1][0] += has_arc(seed2, seed1);
+
+    order.clear();
+    for (VertexId i = 0; i < static_cast<VertexId>(vertex_count); ++i) {
+        if (i != seed1 && i != seed2) {
+            order.push_back(i);
+        }
+    }
+
+    std::shuffle(
+        order.begin(),
+        order.end(),
+        RandomNumerGenerator::get_generator()
+    );
+
+    for (VertexId vertex : order) {
+        std::array<EdgeScore, binarySplitCount> out_score{};
+        std::array<EdgeScore, binarySplitCount> in_score{};
+        const std::uint64_t* out_row = dense.out_row(vertex);
+        const std::uint64_t* in_row = dense.in_row(vertex);
+
+        const std::uint64_t* side0 = side_bits.data();
+        const std::uint64_t* side1 = side0 + words;
+        for (std::size_t word = 0; word < words; ++word) {
+            out_score[0] += std::popcount(out_row[word] & side0[word]);
+            out_score[1] += std::popcount(out_row[word] & side1[word]);
+        }
+        if (dense.directed) {
+            for (std::size_t word = 0; word < words; ++word) {
+                in_score[0] += std::popcount(in_row[word] & side0[word]);
+                in_score[1] += std::popcount(in_row[word] & side1[word]);
+            }
+        }
+
+        EdgeScore score0 = out_score[0] + in_score[0];
+        EdgeScore score1 = out_score[1] + in_score[1];
+
+        ClusterId cluster = 0;
+        if (score1 > score0) {
+            cluster = 1;
+        } else if (score0 == score1) {
+            cluster = RandomNumerGenerator::random_int(0, 1);
+        }
+
+        place(vertex, cluster);
+        model.block_matrix[cluster][cluster] += dense.self_loops[vertex];
+
+        for (std::size_t side = 0; side < binarySplitCount; ++side) {
+            model.block_matrix[cluster][side] += out_score[side];
+            // Undirected: mirror entry; directed: arcs arriving from the side
+            model.block_matrix[side][cluster] += dense.directed ? in_score[side] : out_score[side];
+        }
+    }
+
+    return model;
+}
+
+// Completes a partial split (nullCluster = unassigned) with one snowball
+// pass seeded by the vertices already assigned
+template <typename GraphView>
+SplitBlockModel snowball_extend(
+    const GraphView& graph,
+    ClusterAssignment& assignment,
+    VertexList& order) {
+
+    VertexCount vertex_count = graph.get_vertex_count();
+
+    SplitBlockModel model;
+    model.vertex_count = vertex_count;
+
+    order.clear();
+    for (VertexId vertex = 0; vertex < static_cast<VertexId>(vertex_count); ++vertex) {
+        auto side = assignment[vertex];
+        if (side == nullCluster) {
+            order.push_back(vertex);
+            continue;
+        }
+
+        ++model.clusters_sizes[side];
+        for (VertexId neighbor : graph.neighbors(vertex)) {
+            if (assignment[neighbor] != nullCluster) {
+                ++model.block_matrix[side][assignment[neighbor]];
+            }
+        }
+    }
+
+    snowball_grow(graph, assignment, order, model);
+    return model;
+}
+
+// Two-label propagation: starts from a snowball split, then each vertex
+// (seeds excepted) takes the side most of its neighbours are on, keeping its
+// side on ties, until a sweep changes nothing. A side is never emptied.
+template <typename GraphView>
+SplitBlockModel label_propagation_split_proposal(
+    const GraphView& graph,
+    ClusterAssignment& assignment,
+    VertexList& order) {
+
+    SplitBlockModel model = snowball_split_proposal(graph, assignment, order);
+    bool directed = graph.is_directed();
+
+    for (IterationCount sweep = 0; sweep < labelPropagationSweeps; ++sweep) {
+        std::shuffle(order.begin(), order.end(), RandomNumerGenerator::get_generator());
+        bool changed = false;
+
+        for (VertexId vertex : order) {
+            std::array<EdgeScore, binarySplitCount> score{};
+            for (VertexId neighbor : graph.neighbors(vertex)) {
+                if (neighbor != vertex) ++score[assignment[neighbor]];
+            }
+            if (directed) {
+                for (VertexId neighbor : graph.in_neighbors(vertex)) {
+                    if (neighbor != vertex) ++score[assignment[neighbor]];
+                }
+            }
+
+            ClusterId current = assignment[vertex];
+            ClusterId other = 1 - current;
+            if (score[other] > score[current] && model.clusters_sizes[current] > 1) {
+                assignment[vertex] = other;
+                --model.clusters_sizes[current];
+                ++model.clusters_sizes[other];
+                changed = true;
+            }
+        }
+
+        if (!changed) break;
+    }
+
+    return count_split_blocks(graph, assignment);
+}
+
+// Spectral bisection: power iteration on (I + D^-1/2 (A + I) D^-1/2) / 2
+// with the leading eigenvector projected out gives the Fiedler direction of
+// the normalised Laplacian; vertices split by its sign (by the median if
+// every entry has the same sign, by rank if ties leave a side empty).
+// Directed graphs use A + A^T.
+template <typename GraphView>
+SplitBlockModel spectral_split_proposal(
+    const GraphView& graph,
+    ClusterAssignment& assignment,
+    SplitScratch& scratch) {
+
+    auto vertex_count = static_cast<VertexId>(graph.get_vertex_count());
+    bool directed = graph.is_directed();
+    auto& vector = scratch.vector;
+    auto& product = scratch.product;
+    auto& scale = scratch.scale;
+
+    // scale = (degree + 1)^-1/2; the self loop keeps isolated vertices finite
+    scale.assign(vertex_count, 1.0);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        for ([[maybe_unused]] VertexId neighbor : graph.neighbors(vertex)) scale[vertex] += 1.0;
+        if (directed) {
+            for ([[maybe_unused]] VertexId neighbor : graph.in_neighbors(vertex)) scale[vertex] += 1.0;
+        }
+    }
+
+    // Leading eigenvector is proportional to sqrt(degree + 1)
+    Probability leading_norm = 0.0;
+    for (auto& value : scale) {
+        leading_norm += value;
+        value = 1.0 / std::sqrt(value);
+    }
+    leading_norm = std::sqrt(leading_norm);
+
+    auto deflate_and_normalize = [&](std::vector<Probability>& x) {
+        Probability projection = 0.0;
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            projection += x[vertex] / (scale[vertex] * leading_norm);
+        }
+        Probability norm = 0.0;
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            x[vertex] -= projection / (scale[vertex] * leading_norm);
+            norm += x[vertex] * x[vertex];
+        }
+        norm = std::sqrt(norm);
+        if (norm > 0.0) {
+            for (auto& value : x) value /= norm;
+        }
+    };
+
+    std::uniform_real_distribution<Probability> start(-1.0, 1.0);
+    vector.resize(vertex_count);
+    for (auto& value : vector) {
+        value = start(RandomNumerGenerator::get_generator());
+    }
+    deflate_and_normalize(vector);
+
+    product.resize(vertex_count);
+    for (IterationCount iteration = 0; iteration < spectralPowerIterations; ++iteration) {
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            Probability sum = vector[vertex] * scale[vertex];
+            for (VertexId neighbor : graph.neighbors(vertex)) {
+                sum += vector[neighbor] * scale[neighbor];
+            }
+            if (directed) {
+                for (VertexId neighbor : graph.in_neighbors(vertex)) {
+                    sum += vector[neighbor] * scale[neighbor];
+                }
+            }
+            product[vertex] = 0.5 * (vector[vertex] + scale[vertex] * sum); // NOLINT
+        }
+        std::swap(vector, product);
+        deflate_and_normalize(vector);
+    }
+
+    // Back to the Laplacian's coordinates before thresholding
+    VertexCount positive = 0;
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        vector[vertex] *= scale[vertex];
+        positive += vector[vertex] > 0.0 ? 1 : 0;
+    }
+
+    Probability threshold = 0.0;
+    if (positive == 0 || positive == static_cast<VertexCount>(vertex_count)) {
+        product.assign(vector.begin(), vector.end());
+        std::nth_element(product.begin(), product.begin() + vertex_count / 2, product.end());
+        threshold = product[vertex_count / 2];
+    }
+
+    assignment.resize(vertex_count);
+    VertexCount upper = 0;
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        assignment[vertex] = vector[vertex] > threshold ? 1 : 0;
+        upper += assignment[vertex];
+    }
+
+    // Ties at the threshold can still leave a side empty; the upper half by
+    // rank (ties to the higher vertex id) then goes to side 1
+    if ((upper == 0 || upper == static_cast<VertexCount>(vertex_count)) &&
+        vertex_count >= static_cast<VertexId>(binarySplitCount)) {
+        auto& order = scratch.order;
+        order.resize(vertex_count);
+        std::iota(order.begin(), order.end(), 0);
+        std::ranges::nth_element(order, order.begin() + vertex_count / 2, [&vector](VertexId a, VertexId b) {
+            return std::tie(vector[a], a) < std::tie(vector[b], b);
+        });
+        for (VertexId rank = 0; rank < vertex_count; ++rank) {
+            assignment[order[rank]] = rank < vertex_count / 2 ? 0 : 1;
+        }
+    }
+
+    return count_split_blocks(graph, assignment);
+}
+
+// Fiduccia-Mattheyses refinement of a binary split. Each pass moves every
+// vertex once, always the unlocked one with the highest cut gain (arcs to
+// the other side minus arcs to its own), tracking the exact H of the 2x2
+// model after each move; the pass is then rolled back to its best prefix.
+// Gains live in buckets, so picking and updating a vertex is O(1) per arc.
+template <typename GraphView>
+SplitBlockModel fm_refine_split(
+    const GraphView& graph,
+    ClusterAssignment& assignment,
+    FmScratch& fm) {
+
+    auto vertex_count = static_cast<VertexId>(graph.get_vertex_count());
+    bool directed = graph.is_directed();
+
+    SplitBlockModel model = count_split_blocks(graph, assignment);
+    if (vertex_count < static_cast<VertexId>(binarySplitCount)) {
+        return model;
+    }
+
+    fm.out_counts.resize(vertex_count);
+    fm.in_counts.resize(vertex_count);
+    fm.self_loops.resize(vertex_count);
+    fm.gain.resize(vertex_count);
+    fm.bucket_next.resize(vertex_count);
+    fm.bucket_prev.resize(vertex_count);
+
+    // Undirected graphs store both directions, so in-counts equal out-counts
+    auto& in_counts = directed ? fm.in_counts : fm.out_counts;
+
+    auto cut_gain = [&](VertexId vertex) {
+        ClusterId side = assignment[vertex];
+        EdgeScore external = fm.out_counts[vertex][1 - side];
+        EdgeScore internal = fm.out_counts[vertex][side];
+        if (directed) {
+            external += fm.in_counts[vertex][1 - side];
+            internal += fm.in_counts[vertex][side];
+        }
+        return external - internal;
+    };
+
+    EdgeScore max_gain = 0;
+    ClusterId top_bucket = 0;
+
+    auto bucket_insert = [&](VertexId vertex) {
+        auto bucket = static_cast<ClusterId>(fm.gain[vertex] + max_gain);
+        fm.bucket_prev[vertex] = nullCluster;
+        fm.bucket_next[vertex] = fm.bucket_head[bucket];
+        if (fm.bucket_head[bucket] != nullCluster) fm.bucket_prev[fm.bucket_head[bucket]] = vertex;
+        fm.bucket_head[bucket] = vertex;
+        top_bucket = std::max(top_bucket, bucket);
+    };
+
+    auto bucket_remove = [&](VertexId vertex) {
+        auto bucket = static_cast<ClusterId>(fm.gain[vertex] + max_gain);
+        if (fm.bucket_prev[vertex] != nullCluster) {
+            fm.bucket_next[fm.bucket_prev[vertex]] = fm.bucket_next[vertex];
+        } else {
+            fm.bucket_head[bucket] = fm.bucket_next[vertex];
+        }
+        if (fm.bucket_next[vertex] != nullCluster) fm.bucket_prev[fm.bucket_next[vertex]] = fm.bucket_prev[vertex];
+    };
+
+    // A neighbour's count towards `from` moves to `to`; rebucket if unlocked
+    auto shift_count = [&](VertexId neighbor, std::array<EdgeScore, binarySplitCount>& counts,
+                           ClusterId from, ClusterId to) {
+        if (!fm.locked[neighbor]) bucket_remove(neighbor);
+        --counts[from];
+        ++counts[to];
+        if (!fm.locked[neighbor]) {
+            fm.gain[neighbor] = cut_gain(neighbor);
+            bucket_insert(neighbor);
+        }
+    };
+
+    for (IterationCount pass = 0; pass < fmMaxPasses; ++pass) {
+        max_gain = 0;
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            fm.out_counts[vertex] = {};
+            fm.in_counts[vertex] = {};
+            fm.self_loops[vertex] = 0;
+            for (VertexId neighbor : graph.neighbors(vertex)) {
+                if (neighbor == vertex) ++fm.self_loops[vertex];
+                else ++fm.out_counts[vertex][assignment[neighbor]];
+            }
+            if (directed) {
+                for (VertexId neighbor : graph.in_neighbors(vertex)) {
+                    if (neighbor != vertex) ++fm.in_counts[vertex][assignment[neighbor]];
+                }
+            }
+            EdgeScore degree = fm.out_counts[vertex][0] + fm.out_counts[vertex][1] +
+                               (directed ? fm.in_counts[vertex][0] + fm.in_counts[vertex][1] : 0);
+            max_gain = std::max(max_gain, degree);
+        }
+
+        fm.bucket_head.assign(2 * max_gain + 1, nullCluster);
+        fm.locked.assign(vertex_count, false);
+        top_bucket = 0;
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            fm.gain[vertex] = cut_gain(vertex);
+            bucket_insert(vertex);
+        }
+
+        DescriptionLength start_h = model.compute_H();
+        DescriptionLength best_h = start_h;
+        VertexCount best_prefix = 0;
+        fm.moves.clear();
+
+        while (true) {
+            while (top_bucket > 0 && fm.bucket_head[top_bucket] == nullCluster) --top_bucket;
+            VertexId vertex = fm.bucket_head[top_bucket];
+            if (vertex == nullCluster) break;
+
+            bucket_remove(vertex);
+            fm.locked[vertex] = true;
+
+            ClusterId from = assignment[vertex];
+            ClusterId to = 1 - from;
+            if (model.clusters_sizes[from] <= 1) continue;  // Never empty a side
+
+            // Exact 2x2 update: the vertex's row and column change side
+            for (std::size_t side = 0; side < binarySplitCount; ++side) {
+                model.block_matrix[from][side] -= fm.out_counts[vertex][side];
+                model.block_matrix[to][side] += fm.out_counts[vertex][side];
+                model.block_matrix[side][from] -= in_counts[vertex][side];
+                model.block_matrix[side][to] += in_counts[vertex][side];
+            }
+            model.block_matrix[from][from] -= fm.self_loops[vertex];
+            model.block_matrix[to][to] += fm.self_loops[vertex];
+            --model.clusters_sizes[from];
+            ++model.clusters_sizes[to];
+            assignment[vertex] = to;
+            fm.moves.push_back(vertex);
+
+            // Arcs vertex -> u are in-arcs of u, and u -> vertex out-arcs of u
+            for (VertexId neighbor : graph.neighbors(vertex)) {
+                if (neighbor != vertex) shift_count(neighbor, in_counts[neighbor], from, to);
+            }
+            if (directed) {
+                for (VertexId neighbor : graph.in_neighbors(vertex)) {
+                    if (neighbor != vertex) shift_count(neighbor, fm.out_counts[neighbor], from, to);
+                }
+            }
+
+            DescriptionLength h = model.compute_H();
+            if (h < best_h) {
+                best_h = h;
+                best_prefix = fm.moves.size();
+            }
+        }
+
+        // Roll back the moves after the best prefix
+        for (VertexCount idx = fm.moves.size(); idx > best_prefix; --idx) {
+            VertexId vertex = fm.moves[idx - 1];
+            assignment[vertex] = 1 - assignment[vertex];
+        }
+        model = count_split_blocks(graph, assignment);
+
+        if (best_prefix == 0) break;
+    }
+
+    return model;
+}
+
+// One proposal of the chosen kind into scratch.assignment. Mixed mode picks
+// by cluster size and proposal index: small clusters are cheap enough for
+// many snowballs, large ones get one spectral split and label propagation.
+// Snowballs use the bit-matrix path when a non-empty dense form is given.
+template <typename GraphView>
+SplitBlockModel split_proposal(
+    const GraphView& graph,
+    SplitProposer proposer,
+    ProposalCount proposal,
+    SplitScratch& scratch,
+    const DenseSplitGraph* dense = nullptr) {
+
+    if (proposer == SplitProposer::Mixed) {
+        if (graph.get_vertex_count() < mixedProposerMinVertices) {
+            proposer = SplitProposer::Snowball;
+        } else {
+            proposer = (proposal == 0) ? SplitProposer::Spectral : SplitProposer::LabelPropagation;
+        }
+    }
+
+    switch (proposer) {
+        case SplitProposer::Spectral:
+            return spectral_split_proposal(graph, scratch.assignment, scratch);
+        case SplitProposer::LabelPropagation:
+            return label_propagation_split_proposal(graph, scratch.assignment, scratch.order);
+        default:
+            if (dense != nullptr && !dense->empty()) {
+                return dense_snowball_split_proposal(*dense, scratch.assignment, scratch.order, scratch.side_bits);
+            }
+            return snowball_split_proposal(graph, scratch.assignment, scratch.order);
+    }
+}
+
+} // sbp::utils
+
+#endif // SBP_SPLIT_HPP
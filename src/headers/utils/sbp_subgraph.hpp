@@ -0,0 +1,283 @@
+#ifndef SBP_SUBGRAPH_HPP
+#define SBP_SUBGRAPH_HPP
+
+#include "sbp_graph.hpp"
+#include "sbp_consts.hpp"
+#include "sbp_aliases.hpp"
+
+namespace sbp::utils {
+
+// splitmix64 finaliser; summing it over a member set gives an
+// order-independent fingerprint that can also be updated per vertex
+inline Fingerprint vertex_fingerprint(VertexId vertex) {
+    auto z = static_cast<Fingerprint>(vertex) + 0x9E3779B97F4A7C15ULL; // NOLINT
+    z = (z ^ (z >> 30U)) * 0xBF58476D1CE4E5B9ULL; // NOLINT
+    z = (z ^ (z >> 27U)) * 0x94D049BB133111EBULL; // NOLINT
+    return z ^ (z >> 31U); // NOLINT
+}
+
+// Walks the parent's neighbours of one vertex, skipping those outside the
+// cluster and translating the rest to local ids.
+class SubGraphNeighborIterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = VertexId;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = const VertexId*;
+    using reference         = VertexId;
+
+    SubGraphNeighborIterator() = default;
+
+    SubGraphNeighborIterator(
+        NeighborIterator current,
+        const ClusterAssignment* assignment,
+        const VertexMapping* global_to_local,
+        ClusterId cluster)
+        : current_(current),
+          assignment_(assignment),
+          global_to_local_(global_to_local),
+          cluster_(cluster) {
+        skip_foreign();
+    }
+
+    VertexId operator*() const { return (*global_to_local_)[*current_]; }
+
+    SubGraphNeighborIterator& operator++() {
+        ++current_;
+        skip_foreign();
+        return *this;
+    }
+
+    SubGraphNeighborIterator operator++(int) {
+        SubGraphNeighborIterator previous = *this;
+        ++(*this);
+        return previous;
+    }
+
+    bool operator==(const SubGraphNeighborIterator& other) const {
+        return current_ == other.current_;
+    }
+
+private:
+    void skip_foreign() {
+        while (current_ != NeighborIterator{} &&
+               (*assignment_)[*current_] != cluster_) {
+            ++current_;
+        }
+    }
+
+    NeighborIterator current_;
+    const ClusterAssignment* assignment_{nullptr};
+    const VertexMapping* global_to_local_{nullptr};
+    ClusterId cluster_{nullCluster};
+
+}; // SubGraphNeighborIterator
+
+struct SubGraphNeighborRange {
+    SubGraphNeighborIterator first;
+
+    [[nodiscard]] SubGraphNeighborIterator begin() const { return first; }
+    [[nodiscard]] SubGraphNeighborIterator end() const { return {}; }
+
+}; // SubGraphNeighborRange
+
+// Zero-copy view of the subgraph induced by one cluster. Local vertex i is
+// subgraph_mapping[i] in the parent; global_to_local is shared by all views
+// of the same partition and holds each vertex's index inside its cluster.
+struct SubGraph {
+
+    const Graph* parent{nullptr};
+    const ClusterAssignment* parent_assignment{nullptr};
+    const VertexMapping* global_to_local{nullptr};
+    ClusterId cluster{nullCluster};
+    VertexMapping subgraph_mapping;
+
+    [[nodiscard]] VertexCount get_vertex_count() const {
+        return subgraph_mapping.size();
+    }
+
+    // Identifies the member set; the induced subgraph depends on nothing else
+    [[nodiscard]] Fingerprint membership_fingerprint() const {
+        Fingerprint fingerprint = 0;
+        for (auto vertex : subgraph_mapping) {
+            fingerprint += vertex_fingerprint(vertex);
+        }
+        return fingerprint;
+    }
+
+    [[nodiscard]] bool is_directed() const {
+        return parent != nullptr && parent->directed;
+    }
+
+    [[nodiscard]] SubGraphNeighborRange neighbors(VertexId local) const {
+        return {SubGraphNeighborIterator(
+            parent->neighbors(subgraph_mapping[local]).begin(),
+            parent_assignment, global_to_local, cluster
+        )};
+    }
+
+    [[nodiscard]] SubGraphNeighborRange in_neighbors(VertexId local) const {
+        return {SubGraphNeighborIterator(
+            parent->in_neighbors(subgraph_mapping[local]).begin(),
+            parent_assignment, global_to_local, cluster
+        )};
+    }
+
+    // Builds a standalone compact Graph for consumers that need one
+    [[nodiscard]] Graph materialize() const {
+        Graph graph;
+        graph.directed = is_directed();
+        graph.adjacency_list.resize(get_vertex_count());
+
+        for (VertexId local = 0;
+             local < static_cast<VertexId>(get_vertex_count());
+             ++local) {
+            for (auto neighbor : neighbors(local)) {
+                graph.adjacency_list[local].push_back(neighbor);
+            }
+        }
+
+        graph.build_in_adjacency();
+        return graph;
+    }
+
+    // Compact Graph induced by a subset of local vertices; sample vertex i
+    // is local vertex sample[i]. sample_index is scratch (local -> sample id).
+    [[nodiscard]] Graph materialize_sample(
+        const VertexList& sample,
+        VertexMapping& sample_index) const {
+
+        sample_index.assign(get_vertex_count(), -1);
+        for (VertexId idx = 0; idx < static_cast<VertexId>(sample.size()); ++idx) {
+            sample_index[sample[idx]] = idx;
+        }
+
+        Graph graph;
+        graph.directed = is_directed();
+        graph.adjacency_list.resize(sample.size());
+
+        for (VertexId idx = 0; idx < static_cast<VertexId>(sample.size()); ++idx) {
+            for (auto neighbor : neighbors(sample[idx])) {
+                if (sample_index[neighbor] >= 0) {
+                    graph.adjacency_list[idx].push_back(sample_index[neighbor]);
+                }
+            }
+        }
+
+        graph.build_in_adjacency();
+        return graph;
+    }
+
+}; // SubGraph
+
+// Buckets vertices by label and creates one view per label. Labels outside
+// [0, label_count) are left out of every view.
+inline void build_subgraph_views(
+    const Graph& graph,
+    const ClusterAssignment& labels,
+    ClusterCount label_count,
+    VertexMapping& global_to_local,
+    std::vector<SubGraph>& subgraphs) {
+
+    subgraphs.clear();
+    subgraphs.resize(label_count);
+    global_to_local.assign(labels.size(), -1);
+
+    for (ClusterId label = 0;
+         label < static_cast<ClusterId>(label_count);
+         ++label) {
+        subgraphs[label].parent = &graph;
+        subgraphs[label].parent_assignment = &labels;
+        subgraphs[label].global_to_local = &global_to_local;
+        subgraphs[label].cluster = label;
+    }
+
+    for (VertexId vertex = 0;
+         vertex < static_cast<VertexId>(labels.size());
+         ++vertex) {
+        auto label = labels[vertex];
+        if (label < 0 || label >= static_cast<ClusterId>(label_count)) {
+            continue;
+        }
+
+        auto& members = subgraphs[label].subgraph_mapping;
+        global_to_local[vertex] = static_cast<VertexId>(members.size());
+        members.push_back(vertex);
+    }
+}
+
+// Per-cluster member lists kept in step with a changing assignment. Moves
+// are swap-removes, O(1) per vertex, and each cluster's fingerprint is
+// updated alongside, so nothing is rebuilt from the whole vertex set.
+// position doubles as the global_to_local map of the views it refreshes.
+struct ClusterMembership {
+    std::vector<VertexMapping> members;
+    VertexMapping position;
+    ClusterAssignment cluster;
+    std::vector<Fingerprint> fingerprints;
+    std::vector<bool> dirty;  // Membership changed since the view was refreshed
+
+    void build(const ClusterAssignment& assignment, ClusterCount cluster_count) {
+        members.assign(cluster_count, {});
+        fingerprints.assign(cluster_count, 0);
+        dirty.assign(cluster_count, true);
+        cluster = assignment;
+        position.assign(assignment.size(), -1);
+
+        for (VertexId vertex = 0; vertex < static_cast<VertexId>(assignment.size()); ++vertex) {
+            auto label = assignment[vertex];
+            if (label < 0 || label >= static_cast<ClusterId>(cluster_count)) continue;
+            position[vertex] = static_cast<VertexId>(members[label].size());
+            members[label].push_back(vertex);
+            fingerprints[label] += vertex_fingerprint(vertex);
+        }
+    }
+
+    void resize(ClusterCount cluster_count) {
+        members.resize(cluster_count);
+        fingerprints.resize(cluster_count, 0);
+        dirty.resize(cluster_count, true);
+    }
+
+    // Brings one vertex in line with its current label
+    void sync(VertexId vertex, ClusterId label) {
+        auto previous = cluster[vertex];
+        if (previous == label) return;
+
+        if (previous >= 0) {
+            auto& from = members[previous];
+            auto hole = position[vertex];
+            from[hole] = from.back();
+            position[from[hole]] = hole;
+            from.pop_back();
+            fingerprints[previous] -= vertex_fingerprint(vertex);
+            dirty[previous] = true;
+        }
+
+        position[vertex] = static_cast<VertexId>(members[label].size());
+        members[label].push_back(vertex);
+        fingerprints[label] += vertex_fingerprint(vertex);
+        dirty[label] = true;
+        cluster[vertex] = label;
+    }
+
+    // Points a view at one cluster's current members; the caller clears
+    // dirty[label] (kept out of here so views can refresh in parallel)
+    void refresh_view(
+        const Graph& graph,
+        const ClusterAssignment& assignment,
+        ClusterId label,
+        SubGraph& view) const {
+
+        view.parent = &graph;
+        view.parent_assignment = &assignment;
+        view.global_to_local = &position;
+        view.cluster = label;
+        view.subgraph_mapping = members[label];
+    }
+
+}; // ClusterMembership
+
+} // sbp::utils
+
+#endif // SBP_SUBGRAPH_HPP
@@ -4,11 +4,16 @@
 #include "sbp_rng.hpp"
 #include "sbp_graph.hpp"
 #include "sbp_aliases.hpp"
+#include "sbp_split.hpp"
 #include "sbp_consts.hpp"
+#include "sbp_subgraph.hpp"
+#include "sbp_merge.hpp"
+#include "sbp_schedule.hpp"
 #include "sbp_blockmodel.hpp"
 
 #include <omp.h>
 #include <cmath>
+#include <atomic>
 #include <chrono>
 
 #if defined(_WIN32)
@@ -27,47 +32,50 @@
 
 namespace sbp::utils {
 
-inline DescriptionLength compute_H(const BlockModel& block_model) {
-    if (block_model.graph == nullptr || 
-        block_model.cluster_count <= 0) {
-        return inf;
-    }
+// H from raw block counts; lets split evaluation score a partition without
+// building a Graph-backed BlockModel
+template <typename Matrix, typename Sizes>
+inline DescriptionLength compute_H_from_counts(
+    const Matrix& block_matrix,
+    const Sizes& clusters_sizes,
+    ClusterCount cluster_count,
+    VertexCount vertex_count) {
 
     Entropy entropy = 0.0;
     for (ClusterId i = 0; 
-         i < static_cast<ClusterId>(block_model.cluster_count); 
+         i < static_cast<ClusterId>(cluster_count); 
         ++i) {
 
-        if (block_model.clusters_sizes[i] == 0) {
+        if (clusters_sizes[i] == 0) {
             continue;
         }
 
         for (ClusterId j = 0; 
-             j < static_cast<ClusterId>(block_model.cluster_count); 
+             j < static_cast<ClusterId>(cluster_count); 
             ++j) {
 
-            if (block_model.clusters_sizes[j] == 0 || 
-                block_model.block_matrix[i][j] <= 0) {
+            if (clusters_sizes[j] == 0 || 
+                block_matrix[i][j] <= 0) {
                 continue;
             }
 
             Probability p_ij = (
-                static_cast<Probability>(block_model.block_matrix[i][j]) /
+                static_cast<Probability>(block_matrix[i][j]) /
                 static_cast<Probability>(
-                    block_model.clusters_sizes[i] * block_model.clusters_sizes[j]
+                    clusters_sizes[i] * clusters_sizes[j]
                 )
             );
 
             entropy += static_cast<Entropy>(
-                block_model.block_matrix[i][j] * std::log(p_ij)
+                block_matrix[i][j] * std::log(p_ij)
             );
         }
     }
 
     Probability model_complexity = (
-        0.5 * block_model.cluster_count *  //NOLINT
-        (block_model.cluster_count + 1) * 
-        std::log(block_model.graph->get_vertex_count())
+        0.5 * cluster_count *  //NOLINT
+        (cluster_count + 1) * 
+        std::log(vertex_count)
     );
 
     return static_cast <DescriptionLength>(
@@ -75,6 +83,20 @@ inline DescriptionLength compute_H(const BlockModel& block_model) {
     );
 }
 
+inline DescriptionLength compute_H(const BlockModel& block_model) {
+    if (block_model.graph == nullptr || 
+        block_model.cluster_count <= 0) {
+        return inf;
+    }
+
+    return compute_H_from_counts(
+        block_model.block_matrix,
+        block_model.clusters_sizes,
+        block_model.cluster_count,
+        block_model.graph->get_vertex_count()
+    );
+}
+
 inline Probability calculate_nmi(
     const ClusterAssignment& true_assignment, 
     const ClusterAssignment& output_assingment)  {
@@ -158,18 +180,22 @@ inline ClusterId mcmc_proposal(
     const BlockModel& block_model, 
     VertexId vertex) {
     
-    const auto& neighbors = graph.adjacency_list[vertex];
+    VertexCount out_degree = graph.degree(vertex);
+    VertexCount total_degree = out_degree + graph.in_degree(vertex);
 
-    if (neighbors.empty()) { // Stay in same cluster
+    if (total_degree == 0) { // Stay in same cluster
         return block_model.cluster_assignment[vertex]; 
     }
     
-    // Choose random neighbor
-    VertexId rand_neighbor = neighbors[
+    // Choose random neighbor (out- or in-neighbour for directed graphs)
+    auto neighbor_idx = static_cast<VertexCount>(
         RandomNumerGenerator::random_int(
-            0, static_cast<int>(neighbors.size() - 1)
+            0, static_cast<int>(total_degree - 1)
         )
-    ];
+    );
+    VertexId rand_neighbor = (neighbor_idx < out_degree)
+        ? graph.neighbor_at(vertex, neighbor_idx)
+        : graph.in_neighbor_at(vertex, neighbor_idx - out_degree);
 
     WeightMap cluster_weights;
     ClusterId neighbor_cluster = block_model.cluster_assignment[rand_neighbor];
@@ -178,11 +204,17 @@ inline ClusterId mcmc_proposal(
          i < static_cast<ClusterId>(block_model.cluster_count); 
          ++i) {
 
-        if (block_model.block_matrix[neighbor_cluster][i] <= 0) {
+        // Directed graphs weight by edges in both directions
+        EdgeCount weight = block_model.block_matrix[neighbor_cluster][i];
+        if (graph.directed) {
+            weight += block_model.block_matrix[i][neighbor_cluster];
+        }
+
+        if (weight <= 0) {
             continue; 
         }
 
-        cluster_weights[i] = block_model.block_matrix[neighbor_cluster][i];
+        cluster_weights[i] = weight;
     }
     
     if (cluster_weights.empty()) {
@@ -212,6 +244,8 @@ inline ClusterId mcmc_proposal(
 }
 
 // Compute ΔH for merging two clusters (used in bottom-up SBP)
+// Rows and columns of c1/c2 are handled separately, so directed block
+// matrices are scored exactly; each entry is removed exactly once.
 inline DescriptionLength compute_delta_H_merge(
     const BlockModel& block_model, 
     ClusterId c1, 
@@ -247,8 +281,8 @@ inline DescriptionLength compute_delta_H_merge(
             );
         }
         
-        // Remove k -> c1 edges (if k != c1 to avoid double counting diagonal)
-        if (k != c1 && block_model.block_matrix[k][c1] > 0) {
+        // Remove k -> c1 edges (rows c1/c2 already cover k == c1 and k == c2)
+        if (k != c1 && k != c2 && block_model.block_matrix[k][c1] > 0) {
             Probability p_k1 = static_cast<Probability>(block_model.block_matrix[k][c1]) / 
                               static_cast<Probability>(nk * n1);
             delta_entropy -= static_cast<Entropy>(
@@ -265,8 +299,8 @@ inline DescriptionLength compute_delta_H_merge(
             );
         }
         
-        // Remove k -> c2 edges (if k != c2)
-        if (k != c2 && block_model.block_matrix[k][c2] > 0) {
+        // Remove k -> c2 edges (rows c1/c2 already cover k == c1 and k == c2)
+        if (k != c1 && k != c2 && block_model.block_matrix[k][c2] > 0) {
             Probability p_k2 = static_cast<Probability>(block_model.block_matrix[k][c2]) / 
                               static_cast<Probability>(nk * n2);
             delta_entropy -= static_cast<Entropy>(
@@ -323,6 +357,123 @@ inline DescriptionLength compute_delta_H_merge(
     return -delta_entropy + delta_complexity;
 }
 
+// Entropy change of merging line c1 with line c2 (rows, or columns) against
+// every other cluster k: the merged line's b log(b / (n_m n_k)) terms minus
+// those of both original lines. Lines are sorted, so one two-pointer walk
+// visits each non-zero once.
+inline Entropy merge_lines_entropy_change(
+    const BlockModel& block_model,
+    const SparseBlockLines& lines,
+    ClusterId c1,
+    ClusterId c2) {
+
+    auto n1 = static_cast<Probability>(block_model.clusters_sizes[c1]);
+    auto n2 = static_cast<Probability>(block_model.clusters_sizes[c2]);
+    Probability n_merged = n1 + n2;
+
+    auto term = [](EdgeCount count, Probability normalizer) {
+        auto edges = static_cast<Probability>(count);
+        return static_cast<Entropy>(edges * std::log(edges / normalizer));
+    };
+
+    Entropy change = 0.0;
+    std::size_t i1 = lines.begin(c1);
+    std::size_t i2 = lines.begin(c2);
+    std::size_t end1 = lines.end(c1);
+    std::size_t end2 = lines.end(c2);
+
+    while (i1 < end1 || i2 < end2) {
+        ClusterId k1 = i1 < end1 ? lines.clusters[i1] : nullCluster;
+        ClusterId k2 = i2 < end2 ? lines.clusters[i2] : nullCluster;
+        ClusterId k = (k2 == nullCluster || (k1 != nullCluster && k1 < k2)) ? k1 : k2;
+
+        EdgeCount b1 = (k == k1) ? lines.counts[i1++] : 0;
+        EdgeCount b2 = (k == k2) ? lines.counts[i2++] : 0;
+        if (k == c1 || k == c2) continue;  // Intra-pair entries are scored separately
+
+        auto nk = static_cast<Probability>(block_model.clusters_sizes[k]);
+        if (b1 > 0) change -= term(b1, n1 * nk);
+        if (b2 > 0) change -= term(b2, n2 * nk);
+        change += term(b1 + b2, n_merged * nk);
+    }
+
+    return change;
+}
+
+// Same ΔH as compute_delta_H_merge, but only the non-zero entries of rows
+// (and, for directed graphs, columns) c1 and c2 are visited, so the cost
+// follows the pair's connectivity instead of K. The sparse snapshot must
+// match block_model.
+inline DescriptionLength compute_delta_H_merge(
+    const BlockModel& block_model,
+    const SparseBlockRows& sparse,
+    ClusterId c1,
+    ClusterId c2) {
+
+    if (block_model.graph == nullptr ||
+        c1 < 0 || c2 < 0 ||
+        c1 >= static_cast<ClusterId>(block_model.cluster_count) ||
+        c2 >= static_cast<ClusterId>(block_model.cluster_count)) {
+        return inf;  // Invalid merge
+    }
+
+    if (c1 == c2) return 0.0;  // No change
+
+    VertexCount n1 = block_model.clusters_sizes[c1];
+    VertexCount n2 = block_model.clusters_sizes[c2];
+    if (n1 == 0 || n2 == 0) return inf;  // Invalid merge
+
+    // Rows c1/c2 against the rest, then columns (the same lines again when
+    // the matrix is symmetric)
+    Entropy delta_entropy = merge_lines_entropy_change(block_model, sparse.rows, c1, c2);
+    delta_entropy += sparse.directed
+        ? merge_lines_entropy_change(block_model, sparse.columns, c1, c2)
+        : delta_entropy;
+
+    // The 2x2 block among c1 and c2 collapses into one self-block
+    const auto& B = block_model.block_matrix;
+    auto intra_term = [](EdgeCount count, VertexCount n_row, VertexCount n_column) {
+        if (count == 0) return Entropy{0.0};
+        auto edges = static_cast<Probability>(count);
+        return static_cast<Entropy>(edges * std::log(edges / static_cast<Probability>(n_row * n_column)));
+    };
+    delta_entropy -= intra_term(B[c1][c1], n1, n1) + intra_term(B[c1][c2], n1, n2) +
+                     intra_term(B[c2][c1], n2, n1) + intra_term(B[c2][c2], n2, n2);
+    delta_entropy += intra_term(B[c1][c1] + B[c2][c2] + B[c1][c2] + B[c2][c1], n1 + n2, n1 + n2);
+
+    // One cluster fewer: 0.5 K (K + 1) log N drops by K log N
+    auto K = static_cast<DescriptionLength>(block_model.cluster_count);
+    DescriptionLength delta_complexity = -K * std::log(block_model.graph->get_vertex_count());
+
+    return -delta_entropy + delta_complexity;
+}
+
+// One MCMC step on a given vertex: propose, keep the move only if H drops
+inline void mcmc_try_move(BlockModel& block_model, VertexId vertex) {
+    ClusterId old_cluster = block_model.cluster_assignment[vertex];
+    
+    // Propose new cluster via MCMC
+    ClusterId new_cluster = mcmc_proposal(*block_model.graph, block_model, vertex);
+    
+    if (new_cluster == old_cluster) {
+        return;
+    }
+    
+    // Calculate delta H for this move
+    DescriptionLength h_before = compute_H(block_model);
+
+    block_model.move_vertex(vertex, new_cluster);
+
+    DescriptionLength h_after = compute_H(block_model);
+    
+    // Accept if improves or with probability based on temperature
+    if (h_after >= h_before) { // Reject: revert move
+        block_model.move_vertex(vertex, old_cluster);
+    } else if (block_model.move_log != nullptr) {
+        block_model.move_log->push_back(vertex);
+    }
+}
+
 // MCMC refinement: iteratively propose moves and accept if they improve H
 inline void mcmc_refine(
     BlockModel& block_model, 
@@ -341,29 +492,40 @@ inline void mcmc_refine(
             0, static_cast<VertexId>(block_model.graph->get_vertex_count() - 1)
         );
 
-        ClusterId old_cluster = block_model.cluster_assignment[vertex];
-        
-        // Propose new cluster via MCMC
-        ClusterId new_cluster = mcmc_proposal(*block_model.graph, block_model, vertex);
-        
-        if (new_cluster == old_cluster) {
-            continue;
-        }
-        
-        // Calculate delta H for this move
-        DescriptionLength h_before = compute_H(block_model);
+        mcmc_try_move(block_model, vertex);
+    }
+    
+    // Stop timing and accumulate
+    auto mcmc_end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> mcmc_duration = mcmc_end - mcmc_start;
+    block_model.total_mcmc_time += mcmc_duration.count();
+}
 
-        block_model.move_vertex(vertex, new_cluster);
+// MCMC refinement restricted to a worklist: proposals only pick vertices
+// from the list, so the cost follows the list size rather than N
+inline void mcmc_refine_vertices(
+    BlockModel& block_model, 
+    const VertexList& worklist,
+    IterationCount num_iterations) {
 
-        DescriptionLength h_after = compute_H(block_model);
-        
-        // Accept if improves or with probability based on temperature
-        if (h_after >= h_before) { // Reject: revert move
-            block_model.move_vertex(vertex, old_cluster);
-        }
+    if (block_model.graph == nullptr || 
+        block_model.cluster_count <= 1 ||
+        worklist.empty()) {
+        return;
+    }
+    
+    auto mcmc_start = std::chrono::high_resolution_clock::now();
+    
+    for (IterationCount iter = 0; iter < num_iterations; ++iter) {
+        VertexId vertex = worklist[
+            RandomNumerGenerator::random_int(
+                0, static_cast<int>(worklist.size() - 1)
+            )
+        ];
+
+        mcmc_try_move(block_model, vertex);
     }
     
-    // Stop timing and accumulate
     auto mcmc_end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> mcmc_duration = mcmc_end - mcmc_start;
     block_model.total_mcmc_time += mcmc_duration.count();
@@ -400,6 +562,122 @@ inline Probability compute_H_normalized(const BlockModel& block_model) {
     );
 }
 
+// Weakly connected components via lock-free union-find. Roots are always
+// hooked under the smaller id, so every root is its component's minimum
+// vertex and labels come out numbered by first vertex. Returns the count.
+inline ClusterCount connected_components(
+    const Graph& graph, 
+    ClusterAssignment& labels) {
+
+    auto vertex_count = static_cast<VertexId>(graph.get_vertex_count());
+    std::vector<std::atomic<VertexId>> parent(vertex_count);
+
+    #pragma omp parallel for schedule(static)
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        parent[vertex].store(vertex, std::memory_order_relaxed);
+    }
+
+    auto find_root = [&parent](VertexId vertex) {
+        while (true) {
+            VertexId up = parent[vertex].load(std::memory_order_relaxed);
+            if (up == vertex) {
+                return vertex;
+            }
+
+            // Path halving; a failed exchange only skips the shortcut
+            VertexId grand_parent = parent[up].load(std::memory_order_relaxed);
+            if (up != grand_parent) {
+                parent[vertex].compare_exchange_weak(up, grand_parent);
+            }
+            vertex = grand_parent;
+        }
+    };
+
+    #pragma omp parallel for schedule(dynamic, OMP_CHUNK_SIZE)
+    for (VertexId vertex_u = 0; vertex_u < vertex_count; ++vertex_u) {
+        // Out-lists alone see every arc once, enough for weak connectivity
+        for (auto vertex_v : graph.neighbors(vertex_u)) {
+            while (true) {
+                VertexId root_u = find_root(vertex_u);
+                VertexId root_v = find_root(vertex_v);
+                if (root_u == root_v) {
+                    break;
+                }
+                if (root_u < root_v) {
+                    std::swap(root_u, root_v);
+                }
+                if (parent[root_u].compare_exchange_strong(root_u, root_v)) {
+                    break;
+                }
+            }
+        }
+    }
+
+    labels.assign(vertex_count, nullCluster);
+    ClusterCount component_count = 0;
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        VertexId root = find_root(vertex);
+        if (root == vertex) {
+            labels[vertex] = static_cast<ClusterId>(component_count++);
+        } else {
+            labels[vertex] = labels[root];  // root < vertex, already labelled
+        }
+    }
+
+    return component_count;
+}
+
+// Peels vertices whose (total) degree is below min_degree. With iterate the
+// peeling repeats on the remaining graph (k-core style); otherwise only the
+// initial low-degree vertices go. Returns 0 for core vertices and nullCluster
+// for peeled ones; peel_order lists the peeled vertices in removal order.
+inline ClusterAssignment peel_low_degree(
+    const Graph& graph,
+    VertexCount min_degree,
+    bool iterate,
+    VertexList& peel_order) {
+
+    auto vertex_count = static_cast<VertexId>(graph.get_vertex_count());
+    ClusterAssignment core_labels(vertex_count, 0);
+    std::vector<VertexCount> degrees(vertex_count, 0);
+    peel_order.clear();
+
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        degrees[vertex] = graph.degree(vertex) + graph.in_degree(vertex);
+        if (degrees[vertex] < min_degree) {
+            core_labels[vertex] = nullCluster;
+            peel_order.push_back(vertex);
+        }
+    }
+
+    if (!iterate) {
+        return core_labels;
+    }
+
+    auto drop_edge = [&](VertexId neighbor) {
+        if (core_labels[neighbor] == nullCluster) {
+            return;
+        }
+        if (--degrees[neighbor] < min_degree) {
+            core_labels[neighbor] = nullCluster;
+            peel_order.push_back(neighbor);
+        }
+    };
+
+    // peel_order doubles as the BFS queue
+    for (std::size_t head = 0; head < peel_order.size(); ++head) {
+        VertexId vertex = peel_order[head];
+        for (auto neighbor : graph.neighbors(vertex)) {
+            drop_edge(neighbor);
+        }
+        for (auto neighbor : graph.in_neighbors(vertex)) {
+            drop_edge(neighbor);
+        }
+    }
+
+    return core_labels;
+}
+
 // Get peak memory usage in MB
 inline MemorySize get_peak_memory_mb() {
 #if defined(_WIN32)
@@ -1,14 +1,9 @@
-#include "headers/utils/sbp_utils.hpp"
+#include "headers/sbp_algorithms.hpp"
 #include <chrono>
 #include <iostream>
 
 using namespace sbp;
 
-namespace sbp {
-    void top_down_sbp(utils::Graph& G, utils::BlockModel& BM, utils::ClusterCount max_clusters, utils::ProposalCount proposals_per_split);
-    void bottom_up_sbp(utils::Graph& G, utils::BlockModel& BM, utils::ClusterCount target_clusters);
-}
-
 // Generates SBM graph and returns the ground truth assignments
 utils::Graph generate_stochastic_block_model_graph(utils::VertexCount n, utils::ClusterCount num_blocks, utils::Probability p_in, utils::Probability p_out, std::vector<utils::ClusterId>& true_assignment) {
     utils::Graph G;
@@ -68,5 +63,25 @@ int main() {
                   << ", NMI: " << nmi << std::endl;
     }
 
+    {
+        // Regression: vertices with no edges share no edge with any cluster,
+        // so a forced merge must still find them instead of merging blocks
+        std::cout << "\n--- Bottom-Up SBP, isolated vertices ---" << std::endl;
+        utils::Graph G_isolated = G;
+        G_isolated.adjacency_list.resize(n + k);
+
+        utils::BlockModel bm;
+        sbp::bottom_up_sbp(G_isolated, bm, k);
+        std::vector<utils::ClusterId> sbm_labels(
+            bm.cluster_assignment.begin(), bm.cluster_assignment.begin() + static_cast<std::ptrdiff_t>(n)
+        );
+        double nmi = utils::calculate_nmi(true_labels, sbm_labels);
+        std::cout << "Clusters: " << bm.cluster_count << ", NMI on the SBM vertices: " << nmi << std::endl;
+        if (nmi < 0.9) {
+            std::cerr << "FAILED: isolated vertices pulled SBM blocks together" << std::endl;
+            return 1;
+        }
+    }
+
     return 0;
 }